@@ -0,0 +1,53 @@
+#include "lexer.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+
+namespace lexer
+{
+    BatchLexerOutput get_tokens_batch(
+        std::vector<std::string> const & file_paths,
+        bool is_global_symbol_table_needed,
+        size_t threads_count,
+        LexerOptions const & options
+    ) noexcept(!IS_DEBUG)
+    {
+        BatchLexerOutput output{};
+        output.files.resize(file_paths.size());
+
+        {
+            ThreadPool thread_pool{ threads_count };
+            for (size_t i = 0; i < file_paths.size(); ++i)
+            {
+                thread_pool.submit([&output, &file_paths, &options, i]()
+                    {
+                        output.files[i] = get_tokens(file_paths[i], options);
+                    });
+            }
+            thread_pool.wait();
+        }
+
+        if (!is_global_symbol_table_needed)
+        {
+            return output;
+        }
+
+        TraceSpan const symbol_merge_span{ TracePhase::SymbolMerge };
+
+        // merged in file order, so global indices are same for any scheduling
+        output.file_to_global_symbol_indices.resize(output.files.size());
+        for (size_t i = 0; i < output.files.size(); ++i)
+        {
+            symbol_table_t const & file_symbol_table = output.files[i].first;
+            std::vector<size_t> & file_to_global = output.file_to_global_symbol_indices[i];
+
+            file_to_global.resize(file_symbol_table.size());
+            for (size_t j = 0; j < file_symbol_table.size(); ++j)
+            {
+                file_to_global[j] = output.symbol_table.insert(file_symbol_table[j]);
+            }
+        }
+
+        return output;
+    }
+}
@@ -0,0 +1,329 @@
+#include "char_scan.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define LEXER_X86_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 kernels are not used by default: on tested cpu they were slower
+// than SSE2 even for runs of 100+ bytes, define LEXER_ENABLE_AVX2 to try them
+#if defined(LEXER_X86_SIMD) && defined(LEXER_ENABLE_AVX2)
+#define LEXER_X86_AVX2
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LEXER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define LEXER_TARGET_AVX2
+#endif
+
+
+namespace lexer
+{
+    namespace
+    {
+        using scan_function_t = size_t(*)(char const * code, size_t position, size_t size) noexcept;
+
+        size_t skip_by_flag(char const * code, size_t position, size_t size, CharFlags flag) noexcept
+        {
+            while (position < size && has_char_flag(code[position], flag))
+            {
+                ++position;
+            }
+            return position;
+        }
+
+        size_t skip_spaces_scalar(char const * code, size_t position, size_t size) noexcept
+        {
+            return skip_by_flag(code, position, size, SpaceFlag);
+        }
+
+        size_t skip_word_part_scalar(char const * code, size_t position, size_t size) noexcept
+        {
+            return skip_by_flag(code, position, size, WordPartFlag);
+        }
+
+#ifdef LEXER_X86_SIMD
+        uint32_t count_trailing_zeros(uint32_t value) noexcept
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, value);
+            return static_cast<uint32_t>(index);
+#else
+            return static_cast<uint32_t>(__builtin_ctz(value));
+#endif
+        }
+
+        // c in [begin, begin + count] as unsigned bytes is checked as
+        // min(c - begin, count) == c - begin
+
+        // bit is set for every character in 16 bytes block that is not space
+        uint32_t not_spaces_mask_sse2(char const * code) noexcept
+        {
+            __m128i const chars = _mm_loadu_si128(reinterpret_cast<__m128i const *>(code));
+            __m128i const from_tab = _mm_sub_epi8(chars, _mm_set1_epi8('\t'));
+            __m128i const is_space = _mm_or_si128(
+                _mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')),
+                _mm_cmpeq_epi8(_mm_min_epu8(from_tab, _mm_set1_epi8('\r' - '\t')), from_tab)
+            );
+            return ~static_cast<uint32_t>(_mm_movemask_epi8(is_space)) & 0xFFFF;
+        }
+
+        // bit is set for every character in 16 bytes block that is not part of word
+        uint32_t not_word_part_mask_sse2(char const * code) noexcept
+        {
+            __m128i const chars = _mm_loadu_si128(reinterpret_cast<__m128i const *>(code));
+            __m128i const from_a = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+            __m128i const from_zero = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+            __m128i const is_word_part = _mm_or_si128(
+                _mm_or_si128(
+                    _mm_cmpeq_epi8(_mm_min_epu8(from_a, _mm_set1_epi8('z' - 'a')), from_a),
+                    _mm_cmpeq_epi8(_mm_min_epu8(from_zero, _mm_set1_epi8('9' - '0')), from_zero)
+                ),
+                _mm_cmpeq_epi8(chars, _mm_set1_epi8('_'))
+            );
+            return ~static_cast<uint32_t>(_mm_movemask_epi8(is_word_part)) & 0xFFFF;
+        }
+
+        size_t skip_spaces_sse2(char const * code, size_t position, size_t size) noexcept
+        {
+            while (position + 16 <= size)
+            {
+                uint32_t const mask = not_spaces_mask_sse2(code + position);
+                if (mask != 0)
+                {
+                    return position + count_trailing_zeros(mask);
+                }
+                position += 16;
+            }
+            return skip_spaces_scalar(code, position, size);
+        }
+
+        size_t skip_word_part_sse2(char const * code, size_t position, size_t size) noexcept
+        {
+            while (position + 16 <= size)
+            {
+                uint32_t const mask = not_word_part_mask_sse2(code + position);
+                if (mask != 0)
+                {
+                    return position + count_trailing_zeros(mask);
+                }
+                position += 16;
+            }
+            return skip_word_part_scalar(code, position, size);
+        }
+
+        size_t find_any_of_sse2(char const * code, size_t position, size_t size, char first, char second) noexcept
+        {
+            __m128i const first_chars = _mm_set1_epi8(first);
+            __m128i const second_chars = _mm_set1_epi8(second);
+
+            while (position + 16 <= size)
+            {
+                __m128i const chars = _mm_loadu_si128(reinterpret_cast<__m128i const *>(code + position));
+                uint32_t const mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(
+                    _mm_cmpeq_epi8(chars, first_chars),
+                    _mm_cmpeq_epi8(chars, second_chars)
+                )));
+                if (mask != 0)
+                {
+                    return position + count_trailing_zeros(mask);
+                }
+                position += 16;
+            }
+            while (position < size && code[position] != first && code[position] != second)
+            {
+                ++position;
+            }
+            return position;
+        }
+
+#ifdef LEXER_X86_AVX2
+        LEXER_TARGET_AVX2 size_t skip_spaces_avx2_loop(char const * code, size_t position, size_t size) noexcept
+        {
+            __m256i const space = _mm256_set1_epi8(' ');
+            __m256i const tab = _mm256_set1_epi8('\t');
+            __m256i const tab_to_cr = _mm256_set1_epi8('\r' - '\t');
+
+            while (position + 32 <= size)
+            {
+                __m256i const chars = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(code + position));
+                __m256i const from_tab = _mm256_sub_epi8(chars, tab);
+                __m256i const is_space = _mm256_or_si256(
+                    _mm256_cmpeq_epi8(chars, space),
+                    _mm256_cmpeq_epi8(_mm256_min_epu8(from_tab, tab_to_cr), from_tab)
+                );
+
+                uint32_t const not_space_mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(is_space));
+                if (not_space_mask != 0)
+                {
+                    return position + count_trailing_zeros(not_space_mask);
+                }
+                position += 32;
+            }
+            return skip_spaces_sse2(code, position, size);
+        }
+
+        // first blocks are checked by SSE2 outside of AVX2 code: most of runs end there,
+        // and entering AVX2 code for short runs costs more than it saves
+        constexpr size_t sse2_blocks_before_avx2 = 4;
+
+        size_t skip_spaces_avx2(char const * code, size_t position, size_t size) noexcept
+        {
+            for (size_t i = 0; i < sse2_blocks_before_avx2 && position + 16 <= size; ++i)
+            {
+                uint32_t const mask = not_spaces_mask_sse2(code + position);
+                if (mask != 0)
+                {
+                    return position + count_trailing_zeros(mask);
+                }
+                position += 16;
+            }
+            if (position + 32 > size)
+            {
+                return skip_spaces_sse2(code, position, size);
+            }
+            return skip_spaces_avx2_loop(code, position, size);
+        }
+
+        LEXER_TARGET_AVX2 size_t skip_word_part_avx2_loop(char const * code, size_t position, size_t size) noexcept
+        {
+            __m256i const lower_bit = _mm256_set1_epi8(0x20);
+            __m256i const a = _mm256_set1_epi8('a');
+            __m256i const a_to_z = _mm256_set1_epi8('z' - 'a');
+            __m256i const zero = _mm256_set1_epi8('0');
+            __m256i const zero_to_nine = _mm256_set1_epi8('9' - '0');
+            __m256i const underscore = _mm256_set1_epi8('_');
+
+            while (position + 32 <= size)
+            {
+                __m256i const chars = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(code + position));
+                __m256i const from_a = _mm256_sub_epi8(_mm256_or_si256(chars, lower_bit), a);
+                __m256i const from_zero = _mm256_sub_epi8(chars, zero);
+                __m256i const is_word_part = _mm256_or_si256(
+                    _mm256_or_si256(
+                        _mm256_cmpeq_epi8(_mm256_min_epu8(from_a, a_to_z), from_a),
+                        _mm256_cmpeq_epi8(_mm256_min_epu8(from_zero, zero_to_nine), from_zero)
+                    ),
+                    _mm256_cmpeq_epi8(chars, underscore)
+                );
+
+                uint32_t const not_word_part_mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(is_word_part));
+                if (not_word_part_mask != 0)
+                {
+                    return position + count_trailing_zeros(not_word_part_mask);
+                }
+                position += 32;
+            }
+            return skip_word_part_sse2(code, position, size);
+        }
+
+        size_t skip_word_part_avx2(char const * code, size_t position, size_t size) noexcept
+        {
+            for (size_t i = 0; i < sse2_blocks_before_avx2 && position + 16 <= size; ++i)
+            {
+                uint32_t const mask = not_word_part_mask_sse2(code + position);
+                if (mask != 0)
+                {
+                    return position + count_trailing_zeros(mask);
+                }
+                position += 16;
+            }
+            if (position + 32 > size)
+            {
+                return skip_word_part_sse2(code, position, size);
+            }
+            return skip_word_part_avx2_loop(code, position, size);
+        }
+
+        bool is_avx2_supported() noexcept
+        {
+#ifdef _MSC_VER
+            int info[4]{};
+            __cpuid(info, 0);
+            if (info[0] < 7)
+            {
+                return false;
+            }
+
+            __cpuid(info, 1);
+            bool const is_osxsave = (info[2] & (1 << 27)) != 0;
+            bool const is_avx = (info[2] & (1 << 28)) != 0;
+            // ymm registers are saved by os
+            if (!is_osxsave || !is_avx || (_xgetbv(0) & 0x6) != 0x6)
+            {
+                return false;
+            }
+
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif
+#endif
+
+        scan_function_t select_skip_spaces() noexcept
+        {
+#if defined(LEXER_X86_AVX2)
+            return (is_avx2_supported() ? skip_spaces_avx2 : skip_spaces_sse2);
+#elif defined(LEXER_X86_SIMD)
+            return skip_spaces_sse2;
+#else
+            return skip_spaces_scalar;
+#endif
+        }
+
+        scan_function_t select_skip_word_part() noexcept
+        {
+#if defined(LEXER_X86_AVX2)
+            return (is_avx2_supported() ? skip_word_part_avx2 : skip_word_part_sse2);
+#elif defined(LEXER_X86_SIMD)
+            return skip_word_part_sse2;
+#else
+            return skip_word_part_scalar;
+#endif
+        }
+
+        scan_function_t const skip_spaces_function = select_skip_spaces();
+        scan_function_t const skip_word_part_function = select_skip_word_part();
+    }
+
+    size_t skip_spaces(std::string_view code, size_t position) noexcept
+    {
+        // most of runs are short, so do not start vector scan for them
+        if (position >= code.size() || !has_char_flag(code[position], SpaceFlag))
+        {
+            return position;
+        }
+        if (position + 1 >= code.size() || !has_char_flag(code[position + 1], SpaceFlag))
+        {
+            return position + 1;
+        }
+        return skip_spaces_function(code.data(), position + 2, code.size());
+    }
+
+    size_t skip_word_part(std::string_view code, size_t position) noexcept
+    {
+        return skip_word_part_function(code.data(), position, code.size());
+    }
+
+    size_t find_any_of(std::string_view code, size_t position, char first, char second) noexcept
+    {
+#ifdef LEXER_X86_SIMD
+        return find_any_of_sse2(code.data(), position, code.size(), first, second);
+#else
+        while (position < code.size() && code[position] != first && code[position] != second)
+        {
+            ++position;
+        }
+        return position;
+#endif
+    }
+}
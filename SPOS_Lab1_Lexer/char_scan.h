@@ -0,0 +1,74 @@
+#pragma once
+
+
+#include <cstdint>
+#include <string_view>
+
+
+namespace lexer
+{
+    enum CharFlags : uint8_t
+    {
+        SpaceFlag = 1 << 0,
+        WordPartFlag = 1 << 1,
+        DigitFlag = 1 << 2,
+        HexDigitFlag = 1 << 3,
+        LowerFlag = 1 << 4
+    };
+
+    // locale independent, same as "C" locale std::isspace, std::isdigit, ...
+    struct CharFlagsTable
+    {
+        uint8_t flags[256]{};
+    };
+
+    constexpr CharFlagsTable generate_char_flags_table() noexcept
+    {
+        CharFlagsTable table{};
+
+        for (char const c : std::string_view{ " \t\n\v\f\r" })
+        {
+            table.flags[static_cast<uint8_t>(c)] |= SpaceFlag;
+        }
+        for (size_t c = 0; c < 256; ++c)
+        {
+            bool const is_lower = (c >= 'a' && c <= 'z');
+            bool const is_digit = (c >= '0' && c <= '9');
+
+            if (is_lower || (c >= 'A' && c <= 'Z') || is_digit || c == '_')
+            {
+                table.flags[c] |= WordPartFlag;
+            }
+            if (is_digit)
+            {
+                table.flags[c] |= DigitFlag;
+            }
+            if (is_digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
+            {
+                table.flags[c] |= HexDigitFlag;
+            }
+            if (is_lower)
+            {
+                table.flags[c] |= LowerFlag;
+            }
+        }
+
+        return table;
+    }
+
+    constexpr CharFlagsTable char_flags_table = generate_char_flags_table();
+
+    constexpr bool has_char_flag(char c, CharFlags flag) noexcept
+    {
+        return (char_flags_table.flags[static_cast<uint8_t>(c)] & flag) != 0;
+    }
+
+    // return position of first character that is not space / not part of word,
+    // use SSE2 or AVX2 when cpu supports it
+    size_t skip_spaces(std::string_view code, size_t position) noexcept;
+    size_t skip_word_part(std::string_view code, size_t position) noexcept;
+
+    // return position of first character equal to first or second from position,
+    // code.size() if there is none
+    size_t find_any_of(std::string_view code, size_t position, char first, char second) noexcept;
+}
@@ -0,0 +1,224 @@
+#include "lexer.h"
+#include "lexer_internal.h"
+
+#include <algorithm>
+#include <limits>
+
+
+namespace lexer
+{
+    namespace
+    {
+        // index of first token with offset not less than given one, tokens are sorted by offset
+        size_t lower_bound_token(tokens_t const & tokens, size_t offset) noexcept
+        {
+            size_t begin = 0;
+            size_t end = tokens.size();
+            while (begin < end)
+            {
+                size_t const middle = begin + (end - begin) / 2;
+                if (tokens.offset(middle) < offset)
+                {
+                    begin = middle + 1;
+                }
+                else
+                {
+                    end = middle;
+                }
+            }
+            return begin;
+        }
+    }
+
+    IncrementalLexer::IncrementalLexer(IncrementalLexer const & other) noexcept
+        : options{ other.options },
+        source{ other.source },
+        symbols{ other.symbols },
+        token_store{ other.token_store },
+        all_errors{ other.all_errors },
+        errors{ other.errors },
+        is_line_clean{ other.is_line_clean }
+    {
+        token_store.set_source(nullptr, source);
+    }
+
+    IncrementalLexer & IncrementalLexer::operator=(IncrementalLexer const & other) noexcept
+    {
+        if (this != &other)
+        {
+            *this = IncrementalLexer{ other };
+        }
+        return *this;
+    }
+
+    // short code is moved inside string object, so its view in tokens is not valid after move
+    IncrementalLexer::IncrementalLexer(IncrementalLexer && other) noexcept
+        : options{ other.options },
+        source{ std::move(other.source) },
+        symbols{ std::move(other.symbols) },
+        token_store{ std::move(other.token_store) },
+        all_errors{ std::move(other.all_errors) },
+        errors{ std::move(other.errors) },
+        is_line_clean{ std::move(other.is_line_clean) }
+    {
+        token_store.set_source(nullptr, source);
+    }
+
+    IncrementalLexer & IncrementalLexer::operator=(IncrementalLexer && other) noexcept
+    {
+        options = other.options;
+        source = std::move(other.source);
+        symbols = std::move(other.symbols);
+        token_store = std::move(other.token_store);
+        all_errors = std::move(other.all_errors);
+        errors = std::move(other.errors);
+        is_line_clean = std::move(other.is_line_clean);
+        token_store.set_source(nullptr, source);
+        return *this;
+    }
+
+    bool IncrementalLexer::open_code(std::string code) noexcept
+    {
+        if (code.size() > max_source_size)
+        {
+            return false;
+        }
+
+        source.clear();
+        symbols.clear();
+        token_store.clear();
+        token_store.line_index().clear();
+        all_errors.clear();
+        errors.clear();
+        is_line_clean.clear();
+
+        return edit(0, 0, code);
+    }
+
+    bool IncrementalLexer::edit(size_t begin, size_t end, std::string_view text) noexcept
+    {
+        if (begin > end || end > source.size())
+        {
+            return false;
+        }
+        if (source.size() - (end - begin) + text.size() > max_source_size)
+        {
+            return false;
+        }
+
+        LineIndex & line_index = token_store.line_index();
+        std::ptrdiff_t const delta = static_cast<std::ptrdiff_t>(text.size()) - static_cast<std::ptrdiff_t>(end - begin);
+
+        // lexing restarts from line where no construct is continued from previous lines
+        size_t restart_line = 0;
+        if (!line_index.empty())
+        {
+            restart_line = line_index.line(begin);
+            while (restart_line > 0 && !is_line_clean[restart_line])
+            {
+                --restart_line;
+            }
+        }
+        size_t const restart_offset = (line_index.empty() ? 0 : line_index.line_begin(restart_line));
+
+        // first old line that is not changed by edit
+        size_t old_line = (line_index.empty() ? 0 : line_index.line(end));
+        if (old_line < line_index.size() && line_index.line_begin(old_line) < end)
+        {
+            ++old_line;
+        }
+
+        source.replace(begin, end - begin, text);
+
+        LexerData lexer_data{};
+        lexer_data.data.options = options;
+        // errors of relexed lines are joined with moved ones, so whole code is capped after that
+        lexer_data.data.options.max_token_errors_count = std::numeric_limits<size_t>::max();
+        // symbols are copied to arena: source changes with next edit
+        lexer_data.data.source = source;
+        lexer_data.data.symbol_table = std::move(symbols);
+        lexer_data.next_line_begin = restart_offset;
+
+        std::vector<bool> is_new_line_clean{};
+        bool is_synced = false;
+
+        while (true)
+        {
+            bool const is_clean = !is_between_lines_state_active(lexer_data);
+            if (is_clean && lexer_data.next_line_begin >= begin + text.size())
+            {
+                while (old_line < line_index.size() &&
+                    static_cast<std::ptrdiff_t>(line_index.line_begin(old_line)) + delta <
+                    static_cast<std::ptrdiff_t>(lexer_data.next_line_begin))
+                {
+                    ++old_line;
+                }
+                if (old_line < line_index.size() &&
+                    static_cast<std::ptrdiff_t>(line_index.line_begin(old_line)) + delta ==
+                    static_cast<std::ptrdiff_t>(lexer_data.next_line_begin) &&
+                    is_line_clean[old_line])
+                {
+                    is_synced = true;
+                    break;
+                }
+            }
+
+            if (!next_line(lexer_data))
+            {
+                finish(lexer_data);
+                break;
+            }
+            is_new_line_clean.push_back(is_clean);
+            lex_line(lexer_data);
+        }
+
+        if (!is_synced)
+        {
+            old_line = line_index.size();
+        }
+        size_t const old_sync_offset = (is_synced ? line_index.line_begin(old_line) : std::numeric_limits<size_t>::max());
+
+        symbols = std::move(lexer_data.data.symbol_table);
+
+        size_t const tokens_begin = lower_bound_token(token_store, restart_offset);
+        size_t const tokens_end = lower_bound_token(token_store, old_sync_offset);
+        token_store.splice(tokens_begin, tokens_end, lexer_data.data.tokens);
+        token_store.shift_offsets(tokens_begin + lexer_data.data.tokens.size(), delta);
+
+        token_errors_t new_errors{};
+        new_errors.reserve(all_errors.size() + lexer_data.data.token_errors.size());
+        for (TokenError const & token_error : all_errors)
+        {
+            if (token_error.offset < restart_offset)
+            {
+                new_errors.push_back(token_error);
+            }
+        }
+        new_errors.insert(new_errors.end(), lexer_data.data.token_errors.begin(), lexer_data.data.token_errors.end());
+        for (TokenError token_error : all_errors)
+        {
+            if (token_error.offset >= old_sync_offset)
+            {
+                token_error.offset = static_cast<uint32_t>(token_error.offset + delta);
+                token_error.symbol_offset = static_cast<uint32_t>(token_error.symbol_offset + delta);
+                new_errors.push_back(token_error);
+            }
+        }
+        all_errors = std::move(new_errors);
+        // first error over cap is copied too, it is replaced by TooManyErrors
+        size_t const max_token_errors_count = options.max_token_errors_count;
+        size_t const copied_errors_count = std::min(all_errors.size(), max_token_errors_count) +
+            (all_errors.size() > max_token_errors_count ? 1 : 0);
+        errors.assign(all_errors.begin(), all_errors.begin() + copied_errors_count);
+        cap_token_errors(errors, max_token_errors_count);
+        // symbols of errors are spans of edited code
+        token_store.set_source(nullptr, source);
+
+        line_index.splice(restart_line, old_line, lexer_data.line_index);
+        line_index.shift(restart_line + lexer_data.line_index.size(), delta);
+
+        is_line_clean.erase(is_line_clean.begin() + restart_line, is_line_clean.begin() + old_line);
+        is_line_clean.insert(is_line_clean.begin() + restart_line, is_new_line_clean.begin(), is_new_line_clean.end());
+        return true;
+    }
+}
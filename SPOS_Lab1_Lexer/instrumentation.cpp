@@ -0,0 +1,155 @@
+#include "instrumentation.h"
+
+#include <iomanip>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+
+namespace lexer
+{
+#ifdef LEXER_ENABLE_INSTRUMENTATION
+    namespace
+    {
+        struct InstrumentationRegistry
+        {
+            std::mutex mutex{};
+            std::vector<ThreadInstrumentationCounters *> threads{};
+            // counters of threads that are finished
+            InstrumentationReport finished_threads{};
+        };
+
+        // never destroyed: thread counters may be destroyed after static objects
+        InstrumentationRegistry & get_registry() noexcept
+        {
+            static InstrumentationRegistry * const registry = new InstrumentationRegistry{};
+            return *registry;
+        }
+    }
+
+    ThreadInstrumentationCounters::ThreadInstrumentationCounters() noexcept
+    {
+        InstrumentationRegistry & registry = get_registry();
+        std::lock_guard<std::mutex> lock{ registry.mutex };
+        registry.threads.push_back(this);
+    }
+
+    ThreadInstrumentationCounters::~ThreadInstrumentationCounters() noexcept
+    {
+        InstrumentationRegistry & registry = get_registry();
+        std::lock_guard<std::mutex> lock{ registry.mutex };
+        collect(registry.finished_threads);
+        registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), this));
+    }
+
+    void ThreadInstrumentationCounters::collect(InstrumentationReport & report) const noexcept
+    {
+        for (uint8_t i = 0; i < static_cast<uint8_t>(InstrumentedScope::CountOf); ++i)
+        {
+            report.scopes[i].calls_count += scopes[i].calls_count.load(std::memory_order_relaxed);
+            report.scopes[i].bytes_count += scopes[i].bytes_count.load(std::memory_order_relaxed);
+            report.scopes[i].ticks += scopes[i].ticks.load(std::memory_order_relaxed);
+        }
+        report.symbol_table_hits += symbol_table_hits.load(std::memory_order_relaxed);
+        report.symbol_table_misses += symbol_table_misses.load(std::memory_order_relaxed);
+    }
+
+    void ThreadInstrumentationCounters::reset() noexcept
+    {
+        for (Scope & scope : scopes)
+        {
+            scope.calls_count.store(0, std::memory_order_relaxed);
+            scope.bytes_count.store(0, std::memory_order_relaxed);
+            scope.ticks.store(0, std::memory_order_relaxed);
+        }
+        symbol_table_hits.store(0, std::memory_order_relaxed);
+        symbol_table_misses.store(0, std::memory_order_relaxed);
+    }
+
+    InstrumentationReport get_instrumentation_report() noexcept
+    {
+        InstrumentationRegistry & registry = get_registry();
+        std::lock_guard<std::mutex> lock{ registry.mutex };
+
+        InstrumentationReport report = registry.finished_threads;
+        for (ThreadInstrumentationCounters const * counters : registry.threads)
+        {
+            counters->collect(report);
+        }
+        return report;
+    }
+
+    void reset_instrumentation() noexcept
+    {
+        InstrumentationRegistry & registry = get_registry();
+        std::lock_guard<std::mutex> lock{ registry.mutex };
+
+        registry.finished_threads = {};
+        for (ThreadInstrumentationCounters * counters : registry.threads)
+        {
+            counters->reset();
+        }
+    }
+#else
+    InstrumentationReport get_instrumentation_report() noexcept
+    {
+        return {};
+    }
+
+    void reset_instrumentation() noexcept
+    {
+
+    }
+#endif
+
+    void output_instrumentation_report(std::ostream & os, InstrumentationReport const & report) noexcept
+    {
+        if (!is_instrumentation_enabled)
+        {
+            os << "Instrumentation is compiled out, define LEXER_ENABLE_INSTRUMENTATION\n";
+            return;
+        }
+
+        ScopeStatistics const & next_token = report.scopes[static_cast<uint8_t>(InstrumentedScope::NextToken)];
+
+        os << "Instrumentation:\n";
+        os << std::left << std::setw(32) << "Scope" <<
+            std::right << std::setw(14) << "Calls" <<
+            std::setw(14) << "Bytes" <<
+            std::setw(18) << instrumentation_ticks_unit <<
+            std::setw(10) << "Per call" <<
+            std::setw(8) << "Share" << '\n';
+
+        uint64_t handlers_ticks = 0;
+        for (uint8_t i = 0; i < static_cast<uint8_t>(InstrumentedScope::CountOf); ++i)
+        {
+            ScopeStatistics const & scope = report.scopes[i];
+            if (i != static_cast<uint8_t>(InstrumentedScope::NextToken))
+            {
+                handlers_ticks += scope.ticks;
+            }
+
+            double const per_call = (scope.calls_count == 0 ? 0.0 : static_cast<double>(scope.ticks) / scope.calls_count);
+            double const share = (next_token.ticks == 0 ? 0.0 : 100.0 * scope.ticks / next_token.ticks);
+            os << std::left << std::setw(32) << Instrumented_scope_to_string[i] <<
+                std::right << std::setw(14) << scope.calls_count <<
+                std::setw(14) << scope.bytes_count <<
+                std::setw(18) << scope.ticks <<
+                std::fixed << std::setprecision(1) <<
+                std::setw(10) << per_call <<
+                std::setw(7) << share << "%\n";
+        }
+
+        // next_token time that is not spent in handlers: between lines checks, space skipping and dispatch
+        os << std::left << std::setw(32) << "dispatch" <<
+            std::right << std::setw(46) <<
+            (next_token.ticks > handlers_ticks ? next_token.ticks - handlers_ticks : 0) << '\n';
+
+        uint64_t const lookups_count = report.symbol_table_hits + report.symbol_table_misses;
+        os << "Symbol table: " << lookups_count << " lookups, " <<
+            report.symbol_table_hits << " hits, " <<
+            report.symbol_table_misses << " misses, hit rate " <<
+            std::fixed << std::setprecision(1) <<
+            (lookups_count == 0 ? 0.0 : 100.0 * report.symbol_table_hits / lookups_count) << "%\n";
+    }
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+// instrumentation is compiled out by default, define LEXER_ENABLE_INSTRUMENTATION to turn it on
+#ifdef LEXER_ENABLE_INSTRUMENTATION
+#include <atomic>
+#if defined(_M_X64) || defined(__x86_64__)
+#define LEXER_INSTRUMENTATION_RDTSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#include <chrono>
+#endif
+#endif
+
+
+namespace lexer
+{
+    enum class InstrumentedScope : uint8_t
+    {
+        // whole next_token call: dispatch and handler
+        NextToken,
+
+        // handlers, time of handler includes operator it falls back to
+        Digit,
+        LiteralsConstant,
+        StringConstant,
+        PreprocessorDirectives,
+        Comments,
+        Word,
+        OperatorByFA,
+        PunctuationMarks,
+        InvalidChar,
+
+        CountOf
+    };
+
+    constexpr char const * Instrumented_scope_to_string[static_cast<uint8_t>(InstrumentedScope::CountOf)] =
+    {
+        "next_token",
+
+        "handle_digit",
+        "handle_literals_constant",
+        "handle_string_constant",
+        "handle_preprocessor_directives",
+        "handle_comments",
+        "handle_word",
+        "handle_operator_by_fa",
+        "handle_punctuation_marks",
+        "handle_invalid_char"
+    };
+
+    struct ScopeStatistics
+    {
+        uint64_t calls_count{ 0 };
+        // bytes of line that scope moved over
+        uint64_t bytes_count{ 0 };
+        uint64_t ticks{ 0 };
+    };
+
+    struct InstrumentationReport
+    {
+        ScopeStatistics scopes[static_cast<uint8_t>(InstrumentedScope::CountOf)]{};
+
+        // lookups of symbols in create_new_token
+        uint64_t symbol_table_hits{ 0 };
+        uint64_t symbol_table_misses{ 0 };
+    };
+
+#ifdef LEXER_ENABLE_INSTRUMENTATION
+    constexpr bool is_instrumentation_enabled = true;
+#ifdef LEXER_INSTRUMENTATION_RDTSC
+    constexpr char const * instrumentation_ticks_unit = "cycles";
+#else
+    constexpr char const * instrumentation_ticks_unit = "ns";
+#endif
+
+    inline uint64_t read_instrumentation_ticks() noexcept
+    {
+#ifdef LEXER_INSTRUMENTATION_RDTSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count());
+#endif
+    }
+
+    // counters of one thread: only owner thread writes them, so relaxed load and store is enough,
+    // other threads read them for report, counters of finished threads are kept
+    class ThreadInstrumentationCounters
+    {
+    public:
+        ThreadInstrumentationCounters() noexcept;
+        ~ThreadInstrumentationCounters() noexcept;
+
+        ThreadInstrumentationCounters(ThreadInstrumentationCounters const &) = delete;
+        ThreadInstrumentationCounters & operator=(ThreadInstrumentationCounters const &) = delete;
+
+        void add_scope(InstrumentedScope scope, uint64_t bytes_count, uint64_t ticks) noexcept
+        {
+            Scope & counters = scopes[static_cast<uint8_t>(scope)];
+            add(counters.calls_count, 1);
+            add(counters.bytes_count, bytes_count);
+            add(counters.ticks, ticks);
+        }
+
+        void add_symbol_lookup(bool is_hit) noexcept
+        {
+            add(is_hit ? symbol_table_hits : symbol_table_misses, 1);
+        }
+
+        // adds counters to report
+        void collect(InstrumentationReport & report) const noexcept;
+        void reset() noexcept;
+
+    private:
+        struct Scope
+        {
+            std::atomic<uint64_t> calls_count{ 0 };
+            std::atomic<uint64_t> bytes_count{ 0 };
+            std::atomic<uint64_t> ticks{ 0 };
+        };
+
+        static void add(std::atomic<uint64_t> & counter, uint64_t value) noexcept
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        Scope scopes[static_cast<uint8_t>(InstrumentedScope::CountOf)]{};
+        std::atomic<uint64_t> symbol_table_hits{ 0 };
+        std::atomic<uint64_t> symbol_table_misses{ 0 };
+    };
+
+    inline thread_local ThreadInstrumentationCounters thread_instrumentation_counters{};
+
+    // records call, ticks and bytes that position moved by until end of scope
+    class InstrumentationScope
+    {
+    public:
+        InstrumentationScope(InstrumentedScope scope, size_t const & position) noexcept
+            : scope{ scope },
+            position{ position },
+            begin_position{ position },
+            begin_ticks{ read_instrumentation_ticks() }
+        {
+
+        }
+
+        ~InstrumentationScope() noexcept
+        {
+            uint64_t const end_ticks = read_instrumentation_ticks();
+            thread_instrumentation_counters.add_scope(
+                scope,
+                position > begin_position ? position - begin_position : 0,
+                end_ticks - begin_ticks
+            );
+        }
+
+        InstrumentationScope(InstrumentationScope const &) = delete;
+        InstrumentationScope & operator=(InstrumentationScope const &) = delete;
+
+    private:
+        InstrumentedScope scope;
+        size_t const & position;
+        size_t begin_position;
+        uint64_t begin_ticks;
+    };
+
+    inline void record_symbol_lookup(bool is_hit) noexcept
+    {
+        thread_instrumentation_counters.add_symbol_lookup(is_hit);
+    }
+#else
+    constexpr bool is_instrumentation_enabled = false;
+    constexpr char const * instrumentation_ticks_unit = "";
+
+    class InstrumentationScope
+    {
+    public:
+        InstrumentationScope(InstrumentedScope, size_t const &) noexcept
+        {
+
+        }
+    };
+
+    inline void record_symbol_lookup(bool) noexcept
+    {
+
+    }
+#endif
+
+    // sum of all threads, empty when instrumentation is compiled out
+    InstrumentationReport get_instrumentation_report() noexcept;
+    // must not be called while other threads lex
+    void reset_instrumentation() noexcept;
+
+    void output_instrumentation_report(std::ostream & os, InstrumentationReport const & report) noexcept;
+}
@@ -0,0 +1,328 @@
+#include "lex_cache.h"
+#include "lexer_internal.h"
+#include "token_stream.h"
+
+#include <cassert>
+#include <cstring>
+#include <charconv>
+#include <filesystem>
+#include <random>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+
+
+namespace lexer
+{
+    namespace
+    {
+        namespace fs = std::filesystem;
+
+        constexpr char const * entry_extension = ".lxts";
+        constexpr char const * temporary_extension = ".tmp";
+        // temporary file of process that crashed while writing entry
+        constexpr std::chrono::hours stale_temporary_age{ 1 };
+
+        uint64_t rotate_left(uint64_t value, int shift) noexcept
+        {
+            return (value << shift) | (value >> (64 - shift));
+        }
+
+        uint64_t mix_word(uint64_t hash, uint64_t word) noexcept
+        {
+            word *= 0x87c37b91114253d5;
+            word = rotate_left(word, 31);
+            word *= 0x4cf5ad432745937f;
+            hash ^= word;
+            return rotate_left(hash, 27) * 5 + 0x52dce729;
+        }
+
+        // murmur3 style hash of 8 byte words
+        uint64_t hash_contents(std::string_view text, uint64_t seed) noexcept
+        {
+            uint64_t hash = seed;
+            size_t i = 0;
+            for (; i + sizeof(uint64_t) <= text.size(); i += sizeof(uint64_t))
+            {
+                uint64_t word{};
+                std::memcpy(&word, text.data() + i, sizeof(word));
+                hash = mix_word(hash, word);
+            }
+            if (i < text.size())
+            {
+                uint64_t word{ 0 };
+                std::memcpy(&word, text.data() + i, text.size() - i);
+                hash = mix_word(hash, word);
+            }
+
+            hash ^= text.size();
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccd;
+            hash ^= hash >> 33;
+            hash *= 0xc4ceb9fe1a85ec53;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        // output of same source differs for other options, so they are part of entry name
+        uint64_t get_entry_seed(LexerOptions const & options) noexcept
+        {
+            uint64_t seed = (uint64_t{ lexer_version } << 32) | token_stream_version;
+            seed = mix_word(seed, options.max_token_errors_count);
+            seed = mix_word(seed, options.token_categories);
+            seed = mix_word(seed, options.interned_token_categories);
+            return seed;
+        }
+
+        void append_hex(std::string & string, uint64_t value) noexcept
+        {
+            char buffer[16]{};
+            char * const end = std::to_chars(buffer, buffer + sizeof(buffer), value, 16).ptr;
+            string.append(buffer, end);
+        }
+    }
+
+    LexCache::LexCache(std::string directory, uint64_t max_size) noexcept
+        : directory{ std::move(directory) },
+        max_size{ max_size }
+    {
+        std::error_code error{};
+        fs::create_directories(this->directory, error);
+    }
+
+    lexer_output_t LexCache::get_tokens(std::string const & file_path, LexerOptions const & options) noexcept(!IS_DEBUG)
+    {
+        std::shared_ptr<SourceFile> source_file = std::make_shared<SourceFile>();
+        if (!source_file->open(file_path))
+        {
+            assert(false && "Cannot open file");
+            return {};
+        }
+        std::string_view const source = source_file->text();
+
+        std::string name{};
+        append_hex(name, hash_contents(source, get_entry_seed(options)));
+        name += '-';
+        append_hex(name, source.size());
+        name += entry_extension;
+        std::string const entry_path = (fs::path{ directory } / name).string();
+
+        lexer_output_t lexer_output{};
+        if (load(entry_path, source_file, lexer_output))
+        {
+            ++hits;
+            return lexer_output;
+        }
+        ++misses;
+
+        LexerData lexer_data{};
+        lexer_data.data.options = options;
+        lexer_data.source_file = source_file;
+        set_source(lexer_data, source, std::move(source_file));
+        lexer_output = lex_source(lexer_data);
+
+        store(entry_path, lexer_output);
+        return lexer_output;
+    }
+
+    LexCache::Statistics LexCache::statistics() const noexcept
+    {
+        return { hits.load(), misses.load(), stores.load(), evictions.load() };
+    }
+
+    void LexCache::reset_statistics() noexcept
+    {
+        hits = 0;
+        misses = 0;
+        stores = 0;
+        evictions = 0;
+    }
+
+    bool LexCache::load(
+        std::string const & entry_path,
+        std::shared_ptr<SourceFile> const & source_file,
+        lexer_output_t & lexer_output
+    ) noexcept
+    {
+        std::shared_ptr<TokenStream> stream = std::make_shared<TokenStream>();
+        if (!stream->open(entry_path))
+        {
+            return false;
+        }
+
+        // stream is valid by itself, but its spans must be inside source too
+        size_t const source_size = source_file->text().size();
+        if ((stream->tokens_count() != 0 && stream->offset(stream->tokens_count() - 1) > source_size) ||
+            (stream->lines_count() != 0 && stream->line_begin(stream->lines_count() - 1) > source_size))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < stream->errors_count(); ++i)
+        {
+            TokenError const token_error = stream->error(i);
+            if (token_error.offset > source_size || size_t{ token_error.symbol_offset } + token_error.length > source_size)
+            {
+                return false;
+            }
+        }
+
+        // hit makes entry most recently used
+        std::error_code error{};
+        fs::last_write_time(entry_path, fs::file_time_type::clock::now(), error);
+
+        symbol_table_t & symbol_table = lexer_output.first;
+        tokens_t & tokens = lexer_output.second.first;
+        token_errors_t & token_errors = lexer_output.second.second;
+
+        // symbols stay views into mapped entry
+        std::string_view const text = stream->text();
+        symbol_table.retain_source(stream, text);
+        symbol_table.reserve(stream->symbols_count());
+        for (size_t i = 0; i < stream->symbols_count(); ++i)
+        {
+            symbol_table.insert(stream->symbol(i));
+        }
+
+        tokens.reserve(stream->tokens_count());
+        for (size_t i = 0; i < stream->tokens_count(); ++i)
+        {
+            tokens.push_back((*stream)[i]);
+        }
+
+        LineIndex & line_index = tokens.line_index();
+        line_index.reserve(stream->lines_count());
+        for (size_t i = 0; i < stream->lines_count(); ++i)
+        {
+            line_index.push_line(stream->line_begin(i));
+        }
+
+        // symbols of errors are spans of source that has same contents as lexed one
+        tokens.set_source(source_file, source_file->text());
+
+        token_errors.reserve(stream->errors_count());
+        for (size_t i = 0; i < stream->errors_count(); ++i)
+        {
+            token_errors.push_back(stream->error(i));
+        }
+
+        return true;
+    }
+
+    void LexCache::store(std::string const & entry_path, lexer_output_t const & lexer_output) noexcept
+    {
+        // other process may write same entry now, so every writer has own temporary file
+        std::random_device random_device{};
+        std::string temporary_path = entry_path;
+        temporary_path += '.';
+        append_hex(temporary_path, (uint64_t{ random_device() } << 32) | random_device());
+        temporary_path += temporary_extension;
+
+        std::error_code error{};
+        if (!write_token_stream(temporary_path, lexer_output))
+        {
+            fs::remove(temporary_path, error);
+            return;
+        }
+        uint64_t entry_size = fs::file_size(temporary_path, error);
+        if (error)
+        {
+            entry_size = 0;
+        }
+        // such entry would be evicted at once with all others
+        if (entry_size > max_size)
+        {
+            fs::remove(temporary_path, error);
+            return;
+        }
+
+        // readers see either no entry or whole one
+        fs::rename(temporary_path, entry_path, error);
+        if (error)
+        {
+            fs::remove(temporary_path, error);
+            return;
+        }
+        ++stores;
+
+        std::lock_guard<std::mutex> const lock{ size_mutex };
+        if (!is_size_known || known_size + entry_size > max_size)
+        {
+            evict();
+            is_size_known = true;
+        }
+        else
+        {
+            known_size += entry_size;
+        }
+    }
+
+    void LexCache::evict() noexcept
+    {
+        struct Entry
+        {
+            fs::file_time_type last_write_time;
+            uint64_t size;
+            fs::path path;
+        };
+
+        std::vector<Entry> entries{};
+        uint64_t total_size = 0;
+        fs::file_time_type const now = fs::file_time_type::clock::now();
+
+        std::error_code error{};
+        for (fs::directory_iterator it{ directory, error }, end{}; !error && it != end; it.increment(error))
+        {
+            fs::path const & path = it->path();
+
+            // entry may be removed by other process at any moment
+            std::error_code time_error{};
+            std::error_code size_error{};
+            fs::file_time_type const last_write_time = fs::last_write_time(path, time_error);
+            uint64_t const size = fs::file_size(path, size_error);
+            if (time_error || size_error)
+            {
+                continue;
+            }
+
+            if (path.extension() == temporary_extension)
+            {
+                if (now - last_write_time > stale_temporary_age)
+                {
+                    fs::remove(path, time_error);
+                }
+            }
+            else if (path.extension() == entry_extension)
+            {
+                entries.push_back({ last_write_time, size, path });
+                total_size += size;
+            }
+        }
+
+        // directory is shrunk below limit, so it is not scanned on every store
+        if (total_size > max_size)
+        {
+            std::sort(entries.begin(), entries.end(), [](Entry const & lhs, Entry const & rhs)
+                {
+                    return lhs.last_write_time < rhs.last_write_time;
+                }
+            );
+
+            uint64_t const target_size = max_size / 4 * 3;
+            for (Entry const & entry : entries)
+            {
+                if (total_size <= target_size)
+                {
+                    break;
+                }
+                // entry that is mapped by reader may be not removable on some systems
+                if (fs::remove(entry.path, error))
+                {
+                    total_size -= entry.size;
+                    ++evictions;
+                }
+            }
+        }
+
+        known_size = total_size;
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+#include "lexer.h"
+
+
+namespace lexer
+{
+    // bump when lexer output for same source changes, entries of other versions are never hit
+    constexpr uint32_t lexer_version = 2;
+
+    // on-disk cache of lexer output: entries are token stream files named by hash and size of file contents,
+    // hash is seeded with lexer and token stream versions and lexer options;
+    // entries are written to temporary files and renamed, so several processes may share one directory,
+    // least recently used entries are removed when directory grows over max_size,
+    // entry that is bigger than max_size is not stored
+    class LexCache
+    {
+    public:
+        struct Statistics
+        {
+            size_t hits;
+            size_t misses;
+            size_t stores;
+            size_t evictions;
+        };
+
+        LexCache(std::string directory, uint64_t max_size) noexcept;
+
+        // same as lexer::get_tokens, file is lexed only on miss
+        lexer_output_t get_tokens(std::string const & file_path, LexerOptions const & options = {}) noexcept(!IS_DEBUG);
+
+        Statistics statistics() const noexcept;
+        void reset_statistics() noexcept;
+
+    private:
+        bool load(
+            std::string const & entry_path,
+            std::shared_ptr<SourceFile> const & source_file,
+            lexer_output_t & lexer_output
+        ) noexcept;
+        void store(std::string const & entry_path, lexer_output_t const & lexer_output) noexcept;
+        void evict() noexcept;
+
+        std::string directory;
+        uint64_t max_size;
+
+        // size of directory on last scan plus entries stored since then,
+        // entries of other processes are seen only on next scan
+        std::mutex size_mutex{};
+        uint64_t known_size{ 0 };
+        bool is_size_known{ false };
+
+        std::atomic<size_t> hits{ 0 };
+        std::atomic<size_t> misses{ 0 };
+        std::atomic<size_t> stores{ 0 };
+        std::atomic<size_t> evictions{ 0 };
+    };
+}
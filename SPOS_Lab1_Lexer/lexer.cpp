@@ -1,76 +1,32 @@
 #include "lexer.h"
+#include "lexer_internal.h"
+#include "char_scan.h"
+#include "instrumentation.h"
+#include "trace.h"
 
-#include <fstream>
 #include <cassert>
-#include <iomanip>
-#include <algorithm>
 
 
 namespace lexer
 {
     bool is_space(char c) noexcept
     {
-        return std::isspace(static_cast<unsigned char>(c));
+        return has_char_flag(c, SpaceFlag);
     }
 
     bool is_digit(char c) noexcept
     {
-        return std::isdigit(static_cast<unsigned char>(c));
+        return has_char_flag(c, DigitFlag);
     }
 
     bool is_lower(char c) noexcept
     {
-        return std::islower(static_cast<unsigned char>(c));
+        return has_char_flag(c, LowerFlag);
     }
 
-    bool is_upper(char c) noexcept
-    {
-        return std::isupper(static_cast<unsigned char>(c));
-    }
-
-    bool is_alpha(char c) noexcept
-    {
-        return std::isalpha(static_cast<unsigned char>(c));
-    }
-
-    bool is_alpha_or_digit(char c) noexcept
-    {
-        return is_alpha(c) || is_digit(c);
-    }
-
-    bool is_valid_word_begin(char c) noexcept
-    {
-        return is_alpha(c) || (c == '_');
-    }
     bool is_valid_word_part(char c) noexcept
     {
-        return is_alpha_or_digit(c) || (c == '_');
-    }
-
-    bool is_operator(char c) noexcept
-    {
-        switch (c)
-        {
-        case '.':
-        case '=':
-        case '+':
-        case '-':
-        case '*':
-        case '/':
-        case '%':
-        case '&':
-        case '|':
-        case '!':
-        case '<':
-        case '>':
-        case '~':
-        case '^':
-        case '?':
-        case ':':
-            return true;
-        default:
-            return false;
-        }
+        return has_char_flag(c, WordPartFlag);
     }
 
     bool is_valid_number_begin(char c) noexcept
@@ -94,7 +50,7 @@ namespace lexer
 
     bool is_hex_number(char c) noexcept
     {
-        return std::isxdigit(static_cast<unsigned char>(c));
+        return has_char_flag(c, HexDigitFlag);
     }
 
     bool is_valid_hex_number_part(char c) noexcept
@@ -102,29 +58,6 @@ namespace lexer
         return (is_hex_number(c) || c == '\'');
     }
 
-    bool is_punctuation_marks(char c) noexcept
-    {
-        switch (c)
-        {
-        case ',':
-        case ';':
-        case '(':
-        case ')':
-        case '[':
-        case ']':
-        case '{':
-        case '}':
-            return true;
-        default:
-            return false;
-        }
-    }
-
-    bool is_valid_symbol_after_number(char c) noexcept
-    {
-        return is_operator(c) || is_space(c) || is_punctuation_marks(c) || c == '/';
-    }
-
     bool is_symbol_type(TokenType type) noexcept
     {
         switch (type)
@@ -181,201 +114,372 @@ namespace lexer
     }
 
 
-    struct FAState
-    {
-        char c{ '\0' };
-        TokenType type{ TokenType::Invalid };
-
-        std::vector<FAState> transitions{};
-    };
+    constexpr size_t operators_begin = static_cast<size_t>(TokenType::OperatorsBegin) + 1;
+    constexpr size_t operators_end = static_cast<size_t>(TokenType::OperatorsEnd);
 
-    static FAState fa_start{};
+    constexpr size_t get_operators_fa_max_states_count() noexcept
+    {
+        // dead state, start state and at most one state for every operator character
+        size_t count = 2;
+        for (size_t i = operators_begin; i < operators_end; ++i)
+        {
+            count += std::string_view{ Token_to_string[i] }.size();
+        }
+        return count;
+    }
 
-    void generate_fa_state(
-        std::vector<std::pair<std::string, TokenType>> const & string_to_type,
-        FAState & state,
-        size_t offset,
-        size_t & position
-    ) noexcept
+    constexpr size_t get_operators_fa_classes_count() noexcept
     {
-        do
+        // class 0 is for all characters that are not part of any operator
+        bool is_used[256]{};
+        size_t count = 1;
+        for (size_t i = operators_begin; i < operators_end; ++i)
         {
-            size_t const last_poistion = position;
-            if (string_to_type[position].first.size() > offset)
+            for (char const c : std::string_view{ Token_to_string[i] })
             {
-                FAState new_state{};
-                generate_fa_state(string_to_type, new_state, offset + 1, position);
-                state.transitions.emplace_back(std::move(new_state));
+                if (!is_used[static_cast<uint8_t>(c)])
+                {
+                    is_used[static_cast<uint8_t>(c)] = true;
+                    ++count;
+                }
             }
-            else
+        }
+        return count;
+    }
+
+    constexpr size_t operators_fa_max_states_count = get_operators_fa_max_states_count();
+    constexpr size_t operators_fa_classes_count = get_operators_fa_classes_count();
+
+    static_assert(operators_fa_max_states_count <= 256, "Operators FA states do not fit in uint8_t");
+
+    constexpr uint8_t operators_fa_dead_state = 0;
+    constexpr uint8_t operators_fa_start_state = 1;
+
+    // trie of all operators as flat state x character class table
+    struct OperatorsFA
+    {
+        uint8_t char_classes[256]{};
+        uint8_t transitions[operators_fa_max_states_count][operators_fa_classes_count]{};
+        // TokenType::Invalid for not accepting states
+        TokenType types[operators_fa_max_states_count]{};
+        size_t states_count{ 0 };
+    };
+
+    constexpr OperatorsFA generate_operators_fa() noexcept
+    {
+        OperatorsFA fa{};
+
+        for (size_t i = 0; i < operators_fa_max_states_count; ++i)
+        {
+            fa.types[i] = TokenType::Invalid;
+        }
+
+        uint8_t classes_count = 1;
+        for (size_t i = operators_begin; i < operators_end; ++i)
+        {
+            for (char const c : std::string_view{ Token_to_string[i] })
             {
-                state.c = string_to_type[position].first[offset - 1];
-                state.type = string_to_type[position].second;
-                ++position;
+                if (fa.char_classes[static_cast<uint8_t>(c)] == 0)
+                {
+                    fa.char_classes[static_cast<uint8_t>(c)] = classes_count;
+                    ++classes_count;
+                }
             }
+        }
 
-            for (size_t i = 0; i < offset && position < string_to_type.size(); ++i)
+        fa.states_count = operators_fa_start_state + 1;
+        for (size_t i = operators_begin; i < operators_end; ++i)
+        {
+            uint8_t state = operators_fa_start_state;
+            for (char const c : std::string_view{ Token_to_string[i] })
             {
-                if (string_to_type[position].first.size() <= i ||
-                    string_to_type[position].first[i] != string_to_type[last_poistion].first[i])
+                uint8_t & next_state = fa.transitions[state][fa.char_classes[static_cast<uint8_t>(c)]];
+                if (next_state == operators_fa_dead_state)
                 {
-                    return;
+                    next_state = static_cast<uint8_t>(fa.states_count);
+                    ++fa.states_count;
                 }
+                state = next_state;
             }
+            fa.types[state] = static_cast<TokenType>(i);
+        }
 
-        } while (position < string_to_type.size());
+        return fa;
     }
 
-    void generate_fa() noexcept
+    constexpr OperatorsFA operators_fa = generate_operators_fa();
+
+    struct PunctuationMarksTable
     {
-        constexpr size_t begin = static_cast<size_t>(TokenType::OperatorsBegin) + 1;
-        constexpr size_t end = static_cast<size_t>(TokenType::OperatorsEnd);
+        // TokenType::Invalid for not punctuation marks
+        TokenType types[256]{};
+    };
 
-        std::vector<std::pair<std::string, TokenType>> string_to_type(end - begin);
+    constexpr PunctuationMarksTable generate_punctuation_marks_table() noexcept
+    {
+        PunctuationMarksTable table{};
 
-        for (size_t i = begin; i < end; ++i)
+        for (size_t c = 0; c < 256; ++c)
+        {
+            table.types[c] = TokenType::Invalid;
+        }
+        for (
+            size_t i = static_cast<size_t>(TokenType::PunctuationMarksBegin) + 1;
+            i < static_cast<size_t>(TokenType::PunctuationMarksEnd);
+            ++i
+            )
         {
-            string_to_type[i - begin] = { Token_to_string[i],  static_cast<TokenType>(i) };
+            table.types[static_cast<uint8_t>(Token_to_string[i][0])] = static_cast<TokenType>(i);
         }
 
-        std::sort(string_to_type.begin(), string_to_type.end());
-        size_t position = 0;
-        generate_fa_state(string_to_type, fa_start, 0, position);
+        return table;
     }
 
+    constexpr PunctuationMarksTable punctuation_marks_table = generate_punctuation_marks_table();
 
-    std::pair<TokenType, bool> try_get_preprocessor_directives(std::string_view word) noexcept
+    bool is_operator(char c) noexcept
     {
-        for (
-            size_t i = static_cast<size_t>(TokenType::PreprocessorDirectivesBegin) + 1;
-            i < static_cast<size_t>(TokenType::PreprocessorDirectivesEnd);
-            ++i
-            )
+        return operators_fa.char_classes[static_cast<uint8_t>(c)] != 0;
+    }
+
+    bool is_punctuation_marks(char c) noexcept
+    {
+        return punctuation_marks_table.types[static_cast<uint8_t>(c)] != TokenType::Invalid;
+    }
+
+    bool is_valid_symbol_after_number(char c) noexcept
+    {
+        return is_operator(c) || is_space(c) || is_punctuation_marks(c);
+    }
+
+    // what starts with character, defines handler in next_token
+    enum class CharClass : uint8_t
+    {
+        Invalid,
+        Number,
+        Character,
+        String,
+        PreprocessorDirectives,
+        Comments,
+        Word,
+        Operator,
+        PunctuationMarks,
+
+        CountOf
+    };
+
+    struct CharClassesTable
+    {
+        CharClass classes[256]{};
+    };
+
+    constexpr CharClassesTable generate_char_classes_table() noexcept
+    {
+        CharClassesTable table{};
+
+        // later assignments have priority: '.' starts number, '/' starts comment
+        for (size_t c = 0; c < 256; ++c)
         {
-            if (word == std::string_view{ Token_to_string[i] })
+            if (operators_fa.char_classes[c] != 0)
             {
-                return { static_cast<TokenType>(i), true };
+                table.classes[c] = CharClass::Operator;
+            }
+            if (punctuation_marks_table.types[c] != TokenType::Invalid)
+            {
+                table.classes[c] = CharClass::PunctuationMarks;
+            }
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')
+            {
+                table.classes[c] = CharClass::Word;
+            }
+            if ((c >= '0' && c <= '9') || c == '.')
+            {
+                table.classes[c] = CharClass::Number;
             }
         }
-        return { TokenType::Invalid, false };
+
+        table.classes[static_cast<uint8_t>('/')] = CharClass::Comments;
+        table.classes[static_cast<uint8_t>('#')] = CharClass::PreprocessorDirectives;
+        table.classes[static_cast<uint8_t>('\"')] = CharClass::String;
+        table.classes[static_cast<uint8_t>('\'')] = CharClass::Character;
+
+        return table;
     }
 
-    std::pair<TokenType, bool> try_get_keywords(std::string_view word) noexcept
+    constexpr CharClassesTable char_classes_table = generate_char_classes_table();
+
+
+    constexpr uint32_t word_hash(std::string_view word, uint32_t seed) noexcept
     {
-        for (
-            size_t i = static_cast<size_t>(TokenType::KeywordsBegin) + 1;
-            i < static_cast<size_t>(TokenType::KeywordsEnd);
-            ++i
-            )
+        // FNV-1a with seed
+        uint32_t hash = 2166136261u ^ seed;
+        for (char const c : word)
         {
-            if (word == std::string_view{ Token_to_string[i] })
-            {
-                return { static_cast<TokenType>(i), true };
-            }
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 16777619u;
         }
-        return { TokenType::Invalid, false };
+        return hash ^ (hash >> 15);
     }
 
-    std::pair<size_t, bool> try_get_from_symbol_table(symbol_table_t const & symbol_table, std::string_view symbol) noexcept
+    // perfect hash table for words from Token_to_string range,
+    // seed is picked at compile time so that every word gets own slot
+    template <size_t SlotsCount>
+    struct WordsTable
+    {
+        static_assert((SlotsCount & (SlotsCount - 1)) == 0, "SlotsCount must be power of two");
+
+        uint32_t seed{ 0 };
+        bool is_perfect{ false };
+        std::string_view words[SlotsCount]{};
+        TokenType types[SlotsCount]{};
+    };
+
+    template <size_t SlotsCount>
+    constexpr WordsTable<SlotsCount> generate_words_table(TokenType begin, TokenType end) noexcept
     {
-        for (size_t i = 0; i < symbol_table.size(); ++i)
+        WordsTable<SlotsCount> table{};
+
+        for (uint32_t seed = 0; seed < 4096 && !table.is_perfect; ++seed)
         {
-            if (symbol == symbol_table[i])
+            table.seed = seed;
+            table.is_perfect = true;
+            for (size_t i = 0; i < SlotsCount; ++i)
+            {
+                table.words[i] = std::string_view{};
+                table.types[i] = TokenType::Invalid;
+            }
+
+            for (
+                size_t i = static_cast<size_t>(begin) + 1;
+                i < static_cast<size_t>(end) && table.is_perfect;
+                ++i
+                )
             {
-                return { i, true };
+                std::string_view const word{ Token_to_string[i] };
+                size_t const slot = word_hash(word, seed) & (SlotsCount - 1);
+                if (table.types[slot] != TokenType::Invalid)
+                {
+                    table.is_perfect = false;
+                }
+                table.words[slot] = word;
+                table.types[slot] = static_cast<TokenType>(i);
             }
         }
 
-        return { std::numeric_limits<size_t>::max(), false };
+        return table;
     }
 
-    struct CommonData
+    constexpr WordsTable<64> preprocessor_directives_table =
+        generate_words_table<64>(TokenType::PreprocessorDirectivesBegin, TokenType::PreprocessorDirectivesEnd);
+    static_assert(preprocessor_directives_table.is_perfect, "No perfect hash for preprocessor directives, increase slots count");
+
+    constexpr WordsTable<256> keywords_table =
+        generate_words_table<256>(TokenType::KeywordsBegin, TokenType::KeywordsEnd);
+    static_assert(keywords_table.is_perfect, "No perfect hash for keywords, increase slots count");
+
+    template <size_t SlotsCount>
+    std::pair<TokenType, bool> try_get_from_words_table(WordsTable<SlotsCount> const & table, std::string_view word) noexcept
     {
-        symbol_table_t symbol_table{};
-        tokens_t tokens{};
-        token_errors_t token_errors{};
-        std::string_view code{};
-        size_t line{ 0 };
-        size_t column{ 0 };
-    };
+        size_t const slot = word_hash(word, table.seed) & (SlotsCount - 1);
+        if (table.types[slot] != TokenType::Invalid && table.words[slot] == word)
+        {
+            return { table.types[slot], true };
+        }
+        return { TokenType::Invalid, false };
+    }
 
-    struct BetweenLinesData
+    std::pair<TokenType, bool> try_get_preprocessor_directives(std::string_view word) noexcept
     {
-        std::string data{ "" };
-        size_t line;
-        size_t column;
-        bool is_active{ false };
-        TokenType type{ TokenType::Invalid };
-    };
+        return try_get_from_words_table(preprocessor_directives_table, word);
+    }
+
+    std::pair<TokenType, bool> try_get_keywords(std::string_view word) noexcept
+    {
+        return try_get_from_words_table(keywords_table, word);
+    }
 
+    // tokens of categories that are filtered out are not created, construct is only scanned over
     void create_new_token(
-        symbol_table_t & symbol_table,
-        tokens_t & tokens,
-        size_t line,
-        size_t column,
+        CommonData & data,
+        size_t offset,
         TokenType type,
         std::string_view symbol = ""
     ) noexcept
     {
-        if (is_symbol_type(type))
+        if (!is_token_category_in(data.options.token_categories, type))
         {
-            std::pair<size_t, bool> const from_symbol_table = try_get_from_symbol_table(symbol_table, symbol);
-            if (from_symbol_table.second)
-            {
-                tokens.push_back({ line, column, type, from_symbol_table.first });
-            }
-            else
-            {
-                tokens.push_back({ line, column, type, symbol_table.size() });
-                symbol_table.push_back(std::string{ symbol });
-            }
+            return;
+        }
+
+        if (is_symbol_type(type) && is_token_category_in(data.options.interned_token_categories, type))
+        {
+            size_t const symbols_count = data.symbol_table.size();
+            size_t const index_in_symbol_table = data.symbol_table.insert(symbol);
+            record_symbol_lookup(index_in_symbol_table < symbols_count);
+
+            data.tokens.push_back({ offset, type, index_in_symbol_table });
         }
         else
         {
-            tokens.push_back({ line, column, type });
+            data.tokens.push_back({ offset, type });
         }
     }
 
-    void create_new_token(
-        symbol_table_t & symbol_table,
-        tokens_t & tokens,
-        BetweenLinesData const & between_lines_data
-    ) noexcept
+    std::string_view get_between_lines_text(CommonData const & data, BetweenLinesData const & between_lines_data) noexcept
     {
-        create_new_token(symbol_table,
-            tokens,
-            between_lines_data.line,
-            between_lines_data.column,
+        return data.source.substr(between_lines_data.begin, between_lines_data.end - between_lines_data.begin);
+    }
+
+    void create_new_token(CommonData & data, BetweenLinesData const & between_lines_data) noexcept
+    {
+        create_new_token(data,
+            between_lines_data.begin,
             between_lines_data.type,
-            between_lines_data.data
+            get_between_lines_text(data, between_lines_data)
         );
     }
 
+    // symbol of error is span [symbol_offset, symbol_offset + length) of source, it is not copied
     void create_new_token_error(
-        token_errors_t & token_errors,
-        std::string const & message,
-        std::string const & symbol,
-        size_t line,
-        size_t column
+        CommonData & data,
+        TokenErrorCode code,
+        size_t offset,
+        size_t symbol_offset,
+        size_t length
     ) noexcept
     {
-        size_t const length = symbol.size();
+        size_t const max_count = data.options.max_token_errors_count;
+        size_t const count = data.token_errors.size() - data.token_errors_begin;
+        if (count > max_count)
+        {
+            return;
+        }
+        if (count == max_count)
+        {
+            data.token_errors.push_back({ TokenErrorCode::TooManyErrors, offset, offset, 0 });
+            return;
+        }
+
+        data.token_errors.push_back({ code, offset, symbol_offset, length });
+    }
 
-        token_errors.push_back({ message, symbol, line, column, length });
+    // error that is reported at start of its symbol
+    void create_new_token_error(CommonData & data, TokenErrorCode code, size_t symbol_offset, size_t length) noexcept
+    {
+        create_new_token_error(data, code, symbol_offset, symbol_offset, length);
     }
 
     void create_new_token_error(
-        token_errors_t & token_errors,
-        std::string const & message,
+        CommonData & data,
+        TokenErrorCode code,
         BetweenLinesData const & between_lines_data
     ) noexcept
     {
         create_new_token_error(
-            token_errors,
-            message,
-            between_lines_data.data,
-            between_lines_data.line,
-            between_lines_data.column
+            data,
+            code,
+            between_lines_data.begin,
+            between_lines_data.end - between_lines_data.begin
         );
     }
 
@@ -405,7 +509,7 @@ namespace lexer
                 handle_operator_by_fa(data);
                 return;
             }
-            create_new_token(data.symbol_table, data.tokens, data.line, start, TokenType::IntNumber, data.code.substr(start, 1));
+            create_new_token(data, data.line_offset + start, TokenType::IntNumber, data.code.substr(start, 1));
             return;
         }
 
@@ -418,7 +522,7 @@ namespace lexer
         }
         if (!is_first_zero && !has_dot && !is_valid_number_begin(next_char))
         {
-            create_new_token(data.symbol_table, data.tokens, data.line, start, TokenType::IntNumber, data.code.substr(start, 1));
+            create_new_token(data, data.line_offset + start, TokenType::IntNumber, data.code.substr(start, 1));
             return;
         }
         if (is_first_zero && next_char == 'b')
@@ -433,7 +537,7 @@ namespace lexer
         }
         else if (!is_valid_number_part(next_char))
         {
-            create_new_token(data.symbol_table, data.tokens, data.line, start, TokenType::IntNumber, data.code.substr(start, 1));
+            create_new_token(data, data.line_offset + start, TokenType::IntNumber, data.code.substr(start, 1));
             return;
         }
 
@@ -459,11 +563,10 @@ namespace lexer
             {
                 ++data.column;
                 create_new_token_error(
-                    data.token_errors,
-                    "Error: double dot in number value",
-                    std::string{ data.code.substr(start, data.column - start) },
-                    data.line,
-                    start
+                    data,
+                    TokenErrorCode::DoubleDotInNumber,
+                    data.line_offset + start,
+                    data.column - start
                 );
                 return;
             }
@@ -473,11 +576,10 @@ namespace lexer
                 {
                     ++data.column;
                     create_new_token_error(
-                        data.token_errors,
-                        "Error: number separator and dot too close",
-                        std::string{ data.code.substr(start, data.column - start) },
-                        data.line,
-                        start
+                        data,
+                        TokenErrorCode::NumberSeparatorAndDotTooClose,
+                        data.line_offset + start,
+                        data.column - start
                     );
                     return;
                 }
@@ -490,11 +592,10 @@ namespace lexer
                 {
                     ++data.column;
                     create_new_token_error(
-                        data.token_errors,
-                        "Error: number separators too close",
-                        std::string{ data.code.substr(start, data.column - start) },
-                        data.line,
-                        start
+                        data,
+                        TokenErrorCode::NumberSeparatorsTooClose,
+                        data.line_offset + start,
+                        data.column - start
                     );
                     return;
                 }
@@ -502,11 +603,10 @@ namespace lexer
                 {
                     ++data.column;
                     create_new_token_error(
-                        data.token_errors,
-                        "Error: dot and number separator too close",
-                        std::string{ data.code.substr(start, data.column - start) },
-                        data.line,
-                        start
+                        data,
+                        TokenErrorCode::DotAndNumberSeparatorTooClose,
+                        data.line_offset + start,
+                        data.column - start
                     );
                     return;
                 }
@@ -519,11 +619,10 @@ namespace lexer
         {
             ++data.column;
             create_new_token_error(
-                data.token_errors,
-                "Error: invalid symbol after number",
-                std::string{ data.code.substr(start, data.column - start) },
-                data.line,
-                start
+                data,
+                TokenErrorCode::InvalidSymbolAfterNumber,
+                data.line_offset + start,
+                data.column - start
             );
             return;
         }
@@ -532,11 +631,10 @@ namespace lexer
             (is_binary && is_binary_number(data.code[data.column - 1]))))
         {
             create_new_token_error(
-                data.token_errors,
-                "Error: invalid number end",
-                std::string{ data.code.substr(start, data.column - start) },
-                data.line,
-                start
+                data,
+                TokenErrorCode::InvalidNumberEnd,
+                data.line_offset + start,
+                data.column - start
             );
             return;
         }
@@ -544,28 +642,27 @@ namespace lexer
         std::string_view const number = data.code.substr(start, data.column - start);
         if (has_dot)
         {
-            create_new_token(data.symbol_table, data.tokens, data.line, start, TokenType::FloatNumber, number);
+            create_new_token(data, data.line_offset + start, TokenType::FloatNumber, number);
         }
         if (!has_dot)
         {
-            create_new_token(data.symbol_table, data.tokens, data.line, start, TokenType::IntNumber, number);
+            create_new_token(data, data.line_offset + start, TokenType::IntNumber, number);
         }
     }
 
     void handle_literals_constant(CommonData & data) noexcept
     {
-        char const c = data.code[data.column];
-
         size_t const start = data.column;
         ++data.column;
+        // errors are reported after their symbols that start at quote
         if (data.column >= data.code.size())
         {
             create_new_token_error(
-                data.token_errors,
-                "Error: unfinished symbol: symbol on end of line",
-                std::string{ c },
-                data.line,
-                data.column
+                data,
+                TokenErrorCode::UnfinishedCharacter,
+                data.line_offset + data.column,
+                data.line_offset + start,
+                1
             );
             return;
         }
@@ -574,30 +671,28 @@ namespace lexer
         if (next_char == '\'')
         {
             create_new_token_error(
-                data.token_errors,
-                "Error: empty character constant",
-                std::string{ c, next_char },
-                data.line,
-                data.column
+                data,
+                TokenErrorCode::EmptyCharacterConstant,
+                data.line_offset + data.column,
+                data.line_offset + start,
+                2
             );
             return;
         }
 
         bool const is_need_additional_char = (next_char == '\\');
-        char additional_char;
         if (is_need_additional_char)
         {
             ++data.column;
-            additional_char = next_char;
 
             if (data.column >= data.code.size())
             {
                 create_new_token_error(
-                    data.token_errors,
-                    "Error: unfinished symbol: symbols on end of line",
-                    std::string{ c, additional_char },
-                    data.line,
-                    data.column
+                    data,
+                    TokenErrorCode::UnfinishedCharacterSymbols,
+                    data.line_offset + data.column,
+                    data.line_offset + start,
+                    2
                 );
                 return;
             }
@@ -607,22 +702,12 @@ namespace lexer
         ++data.column;
         if (data.column >= data.code.size())
         {
-            std::string text;
-            if (is_need_additional_char)
-            {
-                text = std::string{ c, additional_char, next_char };
-            }
-            else
-            {
-                text = std::string{ c, next_char };
-            }
-
             create_new_token_error(
-                data.token_errors,
-                "Error: unfinished symbol: symbols on end of line",
-                text,
-                data.line,
-                data.column
+                data,
+                TokenErrorCode::UnfinishedCharacterSymbols,
+                data.line_offset + data.column,
+                data.line_offset + start,
+                data.column - start
             );
             return;
         }
@@ -630,22 +715,12 @@ namespace lexer
 
         if (last_char != '\'')
         {
-            std::string text;
-            if (is_need_additional_char)
-            {
-                text = std::string{ c, additional_char, next_char, last_char };
-            }
-            else
-            {
-                text = std::string{ c, next_char, last_char };
-            }
-
             create_new_token_error(
-                data.token_errors,
-                "Error: too many characters in symbol constant",
-                text,
-                data.line,
-                data.column
+                data,
+                TokenErrorCode::TooManyCharactersInSymbolConstant,
+                data.line_offset + data.column,
+                data.line_offset + start,
+                data.column + 1 - start
             );
             return;
         }
@@ -653,7 +728,7 @@ namespace lexer
 
         std::string_view const word = data.code.substr(start, data.column - start);
 
-        create_new_token(data.symbol_table, data.tokens, data.line, start, TokenType::Character, word);
+        create_new_token(data, data.line_offset + start, TokenType::Character, word);
     }
 
     void handle_string_constant(CommonData & data, BetweenLinesData & string_constant_data) noexcept
@@ -666,48 +741,54 @@ namespace lexer
 
         bool is_previous_spesial_symbol = false;
 
-        while (data.column < data.code.size() && !(!is_previous_spesial_symbol && data.code[data.column] == '\"'))
+        // jumps between quotes and backslashes, backslash skips next character
+        while (data.column < data.code.size())
         {
-            if (is_previous_spesial_symbol)
+            data.column = find_any_of(data.code, data.column, '\"', '\\');
+            if (data.column >= data.code.size() || data.code[data.column] == '\"')
             {
-                is_previous_spesial_symbol = false;
+                break;
             }
-            else if (!is_previous_spesial_symbol && data.code[data.column] == '\\')
+            if (data.column + 1 >= data.code.size())
             {
                 is_previous_spesial_symbol = true;
+                data.column = data.code.size();
+                break;
             }
-            ++data.column;
+            data.column += 2;
         }
 
         if (data.column >= data.code.size() && is_previous_spesial_symbol)
         {
-            std::string text = std::string{ data.code.substr(start, data.column - start - 1) };
-            if (string_constant_data.is_active)
+            if (!string_constant_data.is_active)
             {
-                string_constant_data.data += std::move(text);
-                return;
+                string_constant_data.begin = data.line_offset + start;
+                string_constant_data.is_active = true;
+            }
+            if (data.column > start)
+            {
+                string_constant_data.end = data.line_offset + data.column;
             }
-            string_constant_data.data = std::move(text);
-            string_constant_data.line = data.line;
-            string_constant_data.column = start;
-            string_constant_data.is_active = true;
             return;
         }
         else if (data.column >= data.code.size())
         {
+            // error of string that is not continued points to end of line
+            size_t error_offset = string_constant_data.begin;
             if (!string_constant_data.is_active)
             {
-                string_constant_data.data = "";
-                string_constant_data.line = data.line;
-                string_constant_data.column = data.column;
+                string_constant_data.begin = data.line_offset + start;
+                error_offset = data.line_offset + data.column;
             }
-            string_constant_data.data += std::string{ data.code.substr(start, data.column - start) };
+            string_constant_data.end = data.line_offset + data.column;
             string_constant_data.is_active = false;
 
             create_new_token_error(
-                data.token_errors,
-                "Error: unfinished string constant",
-                string_constant_data
+                data,
+                TokenErrorCode::UnfinishedStringConstant,
+                error_offset,
+                string_constant_data.begin,
+                string_constant_data.end - string_constant_data.begin
             );
             return;
         }
@@ -717,18 +798,14 @@ namespace lexer
 
         if (string_constant_data.is_active)
         {
-            string_constant_data.data += std::string{ word };
+            string_constant_data.end = data.line_offset + data.column;
             string_constant_data.type = TokenType::String;
-            create_new_token(
-                data.symbol_table,
-                data.tokens,
-                string_constant_data
-            );
+            create_new_token(data, string_constant_data);
             string_constant_data.is_active = false;
             return;
         }
 
-        create_new_token(data.symbol_table, data.tokens, data.line, start, TokenType::String, word);
+        create_new_token(data, data.line_offset + start, TokenType::String, word);
     }
 
     std::pair<TokenType, bool> try_handle_preprocessor_word(CommonData & data) noexcept
@@ -762,13 +839,12 @@ namespace lexer
 
             if (!preprocessor_directives.second)
             {
-                std::string_view const word = data.code.substr(start, data.column - start);
                 create_new_token_error(
-                    data.token_errors,
-                    "Error: undefined preprocessor directives",
-                    std::string{ word },
-                    data.line,
-                    data.column
+                    data,
+                    TokenErrorCode::UndefinedPreprocessorDirectives,
+                    data.line_offset + data.column,
+                    data.line_offset + start,
+                    data.column - start
                 );
                 return;
             }
@@ -777,17 +853,14 @@ namespace lexer
             preprocessor_directives_data.type = type;
             if (is_single_word_preprocessor_directives(type))
             {
-                create_new_token(data.symbol_table, data.tokens, data.line, start, type);
+                create_new_token(data, data.line_offset + start, type);
                 return;
             }
         }
 
         if (is_multi_line_preprocessor_directives(type) && is_emptpy_line)
         {
-            while (is_emptpy_line && data.column < data.code.size() && is_space(data.code[data.column]))
-            {
-                ++data.column;
-            }
+            data.column = skip_spaces(data.code, data.column);
 
             if (data.column < data.code.size() && data.code[data.column] == '#')
             {
@@ -796,11 +869,7 @@ namespace lexer
                 std::pair<TokenType, bool> const preprocessor_directives = try_handle_preprocessor_word(data);
                 if (is_end_of_multi_line_preprocessor_directives(preprocessor_directives.first))
                 {
-                    create_new_token(
-                        data.symbol_table,
-                        data.tokens,
-                        preprocessor_directives_data
-                    );
+                    create_new_token(data, preprocessor_directives_data);
                     preprocessor_directives_data.is_active = false;
 
                     data.column = current_column;
@@ -816,33 +885,17 @@ namespace lexer
         }
 
         if (data.column >= data.code.size() &&
-            (!is_multi_line_preprocessor_directives(type) && data.code.back() == '\\') ||
+            (!is_multi_line_preprocessor_directives(type) && !data.code.empty() && data.code.back() == '\\') ||
             is_multi_line_preprocessor_directives(type))
         {
-            std::string text;
-            if (is_multi_line_preprocessor_directives(type))
-            {
-                text = std::string{ data.code.substr(start, data.column - start) };
-            }
-            else
-            {
-                text = std::string{ data.code.substr(start, data.column - start - 1) };
-            }
-
-            if (preprocessor_directives_data.is_active)
+            if (!preprocessor_directives_data.is_active)
             {
-                preprocessor_directives_data.data += std::move(text);
-                return;
+                preprocessor_directives_data.begin = data.line_offset + start;
+                preprocessor_directives_data.is_active = true;
             }
-            preprocessor_directives_data.data = std::move(text);
-            preprocessor_directives_data.line = data.line;
-            preprocessor_directives_data.column = start;
-            preprocessor_directives_data.is_active = true;
-
-            if (is_multi_line_preprocessor_directives(type))
+            if (data.column > start)
             {
-                // special character to separate condition and action
-                preprocessor_directives_data.data += '$';
+                preprocessor_directives_data.end = data.line_offset + data.column;
             }
             return;
         }
@@ -852,20 +905,28 @@ namespace lexer
             std::string_view const text = data.code.substr(start, data.column - start);
             if (preprocessor_directives_data.is_active)
             {
-                preprocessor_directives_data.data += std::string{ text };
-                create_new_token(
-                    data.symbol_table,
-                    data.tokens,
-                    preprocessor_directives_data
-                );
+                preprocessor_directives_data.end = data.line_offset + data.column;
+                create_new_token(data, preprocessor_directives_data);
                 preprocessor_directives_data.is_active = false;
                 return;
             }
-            create_new_token(data.symbol_table, data.tokens, data.line, start, type, text);
+            create_new_token(data, data.line_offset + start, type, text);
             return;
         }
     }
 
+    // number of c characters right before position, but not before begin
+    size_t count_run_before(std::string_view code, size_t begin, size_t position, char c) noexcept
+    {
+        size_t count = 0;
+        while (position > begin && code[position - 1] == c)
+        {
+            --position;
+            ++count;
+        }
+        return count;
+    }
+
     void handle_comments(CommonData & data, BetweenLinesData & commented_code_data) noexcept
     {
         char const c = data.code[data.column];
@@ -902,54 +963,57 @@ namespace lexer
             }
             else
             {
-                --data.column;
+                data.column = start;
                 handle_operator_by_fa(data);
                 return;
             }
         }
 
         bool is_previous_spesial_symbol = false;
-        bool is_previous_star_symbol = false;
 
         // true - comment like: // ...
         // false - comment like: /* ... */
         bool const is_first_type = (type == TokenType::SingleLineComment);
 
-        while (data.column < data.code.size() && !(!is_first_type && is_previous_star_symbol && data.code[data.column] == '/'))
+        // backslashes and stars pair up: character is escaped by odd number of backslashes
+        // right before it, slash ends comment after odd number of stars
+        size_t const scan_begin = data.column;
+        if (is_first_type)
         {
-            if (is_previous_spesial_symbol)
-            {
-                is_previous_spesial_symbol = false;
-            }
-            else if (!is_previous_spesial_symbol && data.code[data.column] == '\\')
+            data.column = data.code.size();
+            is_previous_spesial_symbol = (count_run_before(data.code, scan_begin, data.column, '\\') % 2 == 1);
+        }
+        else
+        {
+            while (data.column < data.code.size())
             {
-                is_previous_spesial_symbol = true;
-            }
+                size_t const slash_position = data.code.find('/', data.column);
+                if (slash_position == std::string_view::npos)
+                {
+                    data.column = data.code.size();
+                    break;
+                }
 
-            if (is_previous_star_symbol)
-            {
-                is_previous_star_symbol = false;
-            }
-            else if (!is_previous_star_symbol && data.code[data.column] == '*')
-            {
-                is_previous_star_symbol = true;
+                data.column = slash_position;
+                if (count_run_before(data.code, scan_begin, data.column, '*') % 2 == 1)
+                {
+                    break;
+                }
+                ++data.column;
             }
-
-            ++data.column;
         }
 
         if (data.column >= data.code.size() && ((is_previous_spesial_symbol && is_first_type) || !is_first_type))
         {
-            std::string text = std::string{ data.code.substr(start, data.column - start - 1) };
-            if (commented_code_data.is_active)
+            if (!commented_code_data.is_active)
             {
-                commented_code_data.data += std::move(text);
-                return;
+                commented_code_data.begin = data.line_offset + start;
+                commented_code_data.is_active = true;
+            }
+            if (data.column > start)
+            {
+                commented_code_data.end = data.line_offset + data.column;
             }
-            commented_code_data.data = std::move(text);
-            commented_code_data.line = data.line;
-            commented_code_data.column = start;
-            commented_code_data.is_active = true;
             return;
         }
         if ((data.column >= data.code.size() && !is_previous_spesial_symbol && is_first_type) ||
@@ -963,130 +1027,184 @@ namespace lexer
             std::string_view const word = data.code.substr(start, data.column - start);
             if (commented_code_data.is_active)
             {
-                commented_code_data.data += std::string{ word };
-                create_new_token(
-                    data.symbol_table,
-                    data.tokens,
-                    commented_code_data
-                );
+                commented_code_data.end = data.line_offset + data.column;
+                create_new_token(data, commented_code_data);
                 commented_code_data.is_active = false;
                 return;
             }
-            create_new_token(data.symbol_table, data.tokens, data.line, start, type, word);
+            create_new_token(data, data.line_offset + start, type, word);
         }
     }
 
-    void handle_operator_by_fa(CommonData & data, size_t start, FAState const & state) noexcept
+    void handle_operator_by_fa(CommonData & data) noexcept
     {
-        if (data.column >= data.code.size())
+        size_t const start = data.column;
+
+        // longest match: remember last accepting state
+        TokenType type{ TokenType::Invalid };
+        size_t end = start;
+
+        uint8_t state = operators_fa_start_state;
+        while (data.column < data.code.size())
         {
-            if (state.type == TokenType::Invalid)
+            uint8_t const char_class = operators_fa.char_classes[static_cast<uint8_t>(data.code[data.column])];
+            state = operators_fa.transitions[state][char_class];
+            if (state == operators_fa_dead_state)
             {
-                create_new_token_error(
-                    data.token_errors,
-                    "Error: invalid operator",
-                    std::string{ data.code.substr(start, data.column - start) },
-                    data.line,
-                    data.column
-                );
+                break;
             }
-            else
+
+            ++data.column;
+            if (operators_fa.types[state] != TokenType::Invalid)
             {
-                create_new_token(data.symbol_table, data.tokens, data.line, start, state.type);
+                type = operators_fa.types[state];
+                end = data.column;
             }
-            return;
         }
 
-        char const current_char = data.code[data.column];
-        bool const is_current_char_operator = is_operator(current_char);
-
-        if (!is_current_char_operator)
+        if (type == TokenType::Invalid)
         {
-            create_new_token(data.symbol_table, data.tokens, data.line, start, state.type);
+            data.column = start + 1;
+            create_new_token_error(data, TokenErrorCode::InvalidOperator, data.line_offset + start, 1);
             return;
         }
 
-        ++data.column;
-        for (size_t i = 0; i < state.transitions.size(); ++i)
-        {
-            if (state.transitions[i].c == current_char)
-            {
-                handle_operator_by_fa(data, start, state.transitions[i]);
-                return;
-            }
-        }
-
-        if (state.type == TokenType::Invalid)
-        {
-            create_new_token_error(
-                data.token_errors,
-                "Error: invalid operator",
-                std::string{ data.code.substr(start, data.column - start) },
-                data.line,
-                data.column
-            );
-        }
-        else
-        {
-            create_new_token(data.symbol_table, data.tokens, data.line, start, state.type);
-        }
-        --data.column;
-    }
-
-    void handle_operator_by_fa(CommonData & data) noexcept
-    {
-        handle_operator_by_fa(data, data.column, fa_start);
+        data.column = end;
+        create_new_token(data, data.line_offset + start, type);
     }
 
     void handle_word(CommonData & data) noexcept
     {
-        bool has_number = false;
-
         size_t const start = data.column;
-        ++data.column;
-        while (data.column < data.code.size() && is_valid_word_part(data.code[data.column]))
-        {
-            if (!has_number && is_digit(data.code[data.column]))
-            {
-                has_number = true;
-            }
-            ++data.column;
-        }
+        data.column = skip_word_part(data.code, data.column + 1);
 
         std::string_view const word = data.code.substr(start, data.column - start);
 
-        if (!has_number)
+        // keywords have no digits, so words with digits are never found
+        std::pair<TokenType, bool> const try_keywords = try_get_keywords(word);
+        if (try_keywords.second)
         {
-            std::pair<TokenType, bool> const try_keywords = try_get_keywords(word);
-            if (try_keywords.second)
-            {
-                create_new_token(data.symbol_table, data.tokens, data.line, start, try_keywords.first);
-                return;
-            }
+            create_new_token(data, data.line_offset + start, try_keywords.first);
+            return;
         }
 
-        create_new_token(data.symbol_table, data.tokens, data.line, start, TokenType::Id, word);
+        create_new_token(data, data.line_offset + start, TokenType::Id, word);
     }
 
     void handle_punctuation_marks(CommonData & data) noexcept
     {
         char const c = data.code[data.column];
+
+        create_new_token(
+            data,
+            data.line_offset + data.column,
+            punctuation_marks_table.types[static_cast<uint8_t>(c)]
+        );
         ++data.column;
+    }
 
-        for (
-            size_t i = static_cast<size_t>(TokenType::PunctuationMarksBegin) + 1;
-            i < static_cast<size_t>(TokenType::PunctuationMarksEnd);
-            ++i
-            )
-        {
-            if (c == Token_to_string[i][0])
-            {
-                create_new_token(data.symbol_table, data.tokens, data.line, data.column, static_cast<TokenType>(i));
-                return;
-            }
-        }
+    using token_handler_t = bool(*)(
+        CommonData & data,
+        BetweenLinesData & commented_code_data,
+        BetweenLinesData & string_constant_data,
+        BetweenLinesData & preprocessor_directives_data
+    ) noexcept;
+
+    // token handlers return false when construct continues on next line
+
+    bool handle_invalid_char(CommonData & data, BetweenLinesData &, BetweenLinesData &, BetweenLinesData &) noexcept
+    {
+        InstrumentationScope const scope{ InstrumentedScope::InvalidChar, data.column };
+        create_new_token_error(data, TokenErrorCode::UnrecognizedSymbol, data.line_offset + data.column, 1);
+        ++data.column;
+        return true;
+    }
+
+    bool handle_digit(CommonData & data, BetweenLinesData &, BetweenLinesData &, BetweenLinesData &) noexcept
+    {
+        InstrumentationScope const scope{ InstrumentedScope::Digit, data.column };
+        handle_digit(data);
+        return true;
+    }
+
+    bool handle_literals_constant(CommonData & data, BetweenLinesData &, BetweenLinesData &, BetweenLinesData &) noexcept
+    {
+        InstrumentationScope const scope{ InstrumentedScope::LiteralsConstant, data.column };
+        handle_literals_constant(data);
+        return true;
+    }
+
+    bool handle_string_constant(
+        CommonData & data,
+        BetweenLinesData &,
+        BetweenLinesData & string_constant_data,
+        BetweenLinesData &
+    ) noexcept
+    {
+        InstrumentationScope const scope{ InstrumentedScope::StringConstant, data.column };
+        handle_string_constant(data, string_constant_data);
+        return !string_constant_data.is_active;
+    }
+
+    bool handle_preprocessor_directives(
+        CommonData & data,
+        BetweenLinesData &,
+        BetweenLinesData &,
+        BetweenLinesData & preprocessor_directives_data
+    ) noexcept
+    {
+        InstrumentationScope const scope{ InstrumentedScope::PreprocessorDirectives, data.column };
+        handle_preprocessor_directives(data, preprocessor_directives_data);
+        return !preprocessor_directives_data.is_active;
+    }
+
+    bool handle_comments(
+        CommonData & data,
+        BetweenLinesData & commented_code_data,
+        BetweenLinesData &,
+        BetweenLinesData &
+    ) noexcept
+    {
+        InstrumentationScope const scope{ InstrumentedScope::Comments, data.column };
+        handle_comments(data, commented_code_data);
+        return !commented_code_data.is_active;
+    }
+
+    bool handle_word(CommonData & data, BetweenLinesData &, BetweenLinesData &, BetweenLinesData &) noexcept
+    {
+        InstrumentationScope const scope{ InstrumentedScope::Word, data.column };
+        handle_word(data);
+        return true;
     }
 
+    bool handle_operator_by_fa(CommonData & data, BetweenLinesData &, BetweenLinesData &, BetweenLinesData &) noexcept
+    {
+        InstrumentationScope const scope{ InstrumentedScope::OperatorByFA, data.column };
+        handle_operator_by_fa(data);
+        return true;
+    }
+
+    bool handle_punctuation_marks(CommonData & data, BetweenLinesData &, BetweenLinesData &, BetweenLinesData &) noexcept
+    {
+        InstrumentationScope const scope{ InstrumentedScope::PunctuationMarks, data.column };
+        handle_punctuation_marks(data);
+        return true;
+    }
+
+    // indexed by CharClass
+    constexpr token_handler_t token_handlers[static_cast<size_t>(CharClass::CountOf)] =
+    {
+        handle_invalid_char,
+        handle_digit,
+        handle_literals_constant,
+        handle_string_constant,
+        handle_preprocessor_directives,
+        handle_comments,
+        handle_word,
+        handle_operator_by_fa,
+        handle_punctuation_marks
+    };
+
     bool next_token(
         CommonData & data,
         BetweenLinesData & commented_code_data,
@@ -1094,228 +1212,309 @@ namespace lexer
         BetweenLinesData & preprocessor_directives_data
     ) noexcept
     {
+        InstrumentationScope const scope{ InstrumentedScope::NextToken, data.column };
+
         if (string_constant_data.is_active)
         {
-            handle_string_constant(data, string_constant_data);
-            return !string_constant_data.is_active;
+            return handle_string_constant(data, commented_code_data, string_constant_data, preprocessor_directives_data);
         }
         if (commented_code_data.is_active)
         {
-            handle_comments(data, commented_code_data);
-            return !commented_code_data.is_active;
+            return handle_comments(data, commented_code_data, string_constant_data, preprocessor_directives_data);
         }
         if (preprocessor_directives_data.is_active)
         {
-            handle_preprocessor_directives(data, preprocessor_directives_data);
-            return !preprocessor_directives_data.is_active;
+            return handle_preprocessor_directives(data, commented_code_data, string_constant_data, preprocessor_directives_data);
         }
 
-        while (data.column < data.code.size() && is_space(data.code[data.column]))
-        {
-            ++data.column;
-        }
+        data.column = skip_spaces(data.code, data.column);
 
         if (data.column >= data.code.size())
         {
             return false;
         }
 
-        char const c = data.code[data.column];
+        CharClass const char_class = char_classes_table.classes[static_cast<uint8_t>(data.code[data.column])];
 
-        if (is_valid_number_begin(c))
-        {
-            handle_digit(data);
-            return true;
-        }
-        if (c == '\'')
-        {
-            handle_literals_constant(data);
-            return true;
-        }
-        if (c == '\"')
-        {
-            handle_string_constant(data, string_constant_data);
-            return !string_constant_data.is_active;
-        }
-        if (c == '#')
-        {
-            handle_preprocessor_directives(data, preprocessor_directives_data);
-            return !preprocessor_directives_data.is_active;
-        }
-        if (c == '/')
-        {
-            handle_comments(data, commented_code_data);
-            return !commented_code_data.is_active;
-        }
-        if (is_valid_word_begin(c))
+        return token_handlers[static_cast<size_t>(char_class)](
+            data,
+            commented_code_data,
+            string_constant_data,
+            preprocessor_directives_data
+        );
+    }
+
+
+
+    bool set_source(LexerData & lexer_data, std::string_view source, std::shared_ptr<void const> source_owner) noexcept
+    {
+        if (source.size() > max_source_size)
         {
-            handle_word(data);
-            return true;
+            set_source(lexer_data, {}, nullptr);
+            return false;
         }
-        if (is_operator(c))
+
+        lexer_data.data.source = source;
+        lexer_data.data.tokens.set_source(source_owner, source);
+        lexer_data.data.symbol_table.retain_source(std::move(source_owner), source);
+        return true;
+    }
+
+    bool open_source_file(LexerData & lexer_data, std::string const & file_path) noexcept
+    {
+        std::shared_ptr<SourceFile> source_file = std::make_shared<SourceFile>();
+        if (!source_file->open(file_path))
         {
-            handle_operator_by_fa(data);
-            return true;
+            return false;
         }
-        if (is_punctuation_marks(c))
+
+        std::string_view const source = source_file->text();
+        lexer_data.source_file = source_file;
+        return set_source(lexer_data, source, std::move(source_file));
+    }
+
+    // measured on benchmark corpora of ordinary code
+    constexpr size_t bytes_per_token_estimate = 6;
+    constexpr size_t bytes_per_line_estimate = 32;
+
+    void reserve_for_source(LexerData & lexer_data) noexcept
+    {
+        size_t const source_size = lexer_data.data.source.size();
+        lexer_data.data.tokens.reserve(source_size / bytes_per_token_estimate + 1);
+        lexer_data.line_index.reserve(source_size / bytes_per_line_estimate + 1);
+    }
+
+    void lex_whole_source(LexerData & lexer_data) noexcept
+    {
+        // tokens are not drained here, so whole line is lexed at once
+        while (next_line(lexer_data))
         {
-            handle_punctuation_marks(data);
-            return true;
+            lex_line(lexer_data);
         }
+        finish(lexer_data);
 
-        create_new_token_error(
-            data.token_errors,
-            "Error: symbol could not be recognized",
-            { c },
-            data.line,
-            data.column
-        );
-        ++data.column;
-        return true;
+        lexer_data.data.tokens.set_line_index(std::move(lexer_data.line_index));
     }
 
+    lexer_output_t lex_source(LexerData & lexer_data) noexcept
+    {
+        reserve_for_source(lexer_data);
+        lex_whole_source(lexer_data);
 
+        // output is moved out, lexer data is not used after it
+        CommonData & data = lexer_data.data;
+        return { std::move(data.symbol_table), { std::move(data.tokens), std::move(data.token_errors) } };
+    }
 
-    lexer_output_t get_tokens(std::string const & file_path) noexcept(!IS_DEBUG)
+    void cap_token_errors(token_errors_t & token_errors, size_t max_token_errors_count) noexcept
     {
-        std::ifstream file_input{ file_path };
+        if (token_errors.size() > max_token_errors_count)
+        {
+            size_t const offset = token_errors[max_token_errors_count].offset;
+            token_errors[max_token_errors_count] = { TokenErrorCode::TooManyErrors, offset, offset, 0 };
+            token_errors.erase(token_errors.begin() + max_token_errors_count + 1, token_errors.end());
+        }
+    }
 
-        if (!file_input)
+    bool next_line(LexerData & lexer_data) noexcept
+    {
+        std::string_view const source = lexer_data.data.source;
+        size_t const line_begin = lexer_data.next_line_begin;
+
+        if (line_begin >= source.size())
         {
-            assert(false && "Cannot open file");
-            return {};
+            return false;
         }
 
-        if (fa_start.transitions.empty())
+        size_t line_end = source.find('\n', line_begin);
+        if (line_end == std::string_view::npos)
         {
-            generate_fa();
+            line_end = source.size();
         }
+        lexer_data.next_line_begin = line_end + 1;
 
-        CommonData data{};
+        // same as text mode input on Windows
+        if (line_end > line_begin && source[line_end - 1] == '\r')
+        {
+            --line_end;
+        }
 
-        BetweenLinesData commented_code_data{};
-        BetweenLinesData string_constant_data{};
-        BetweenLinesData preprocessor_directives_data{};
+        lexer_data.line_index.push_line(line_begin);
+        lexer_data.data.code = source.substr(line_begin, line_end - line_begin);
+        lexer_data.data.line_offset = line_begin;
+        lexer_data.data.column = 0;
+        return true;
+    }
 
-        std::string code;
+    bool next_token(LexerData & lexer_data) noexcept
+    {
+        return next_token(
+            lexer_data.data,
+            lexer_data.commented_code_data,
+            lexer_data.string_constant_data,
+            lexer_data.preprocessor_directives_data
+        );
+    }
 
-        while (std::getline(file_input, code))
+    void lex_line(LexerData & lexer_data) noexcept
+    {
+        while (next_token(lexer_data))
         {
-            data.code = code;
-            data.column = 0;
-            while (next_token(
-                data,
-                commented_code_data,
-                string_constant_data,
-                preprocessor_directives_data
-            ))
-            {
 
-            }
-            ++data.line;
         }
+    }
 
-        if (commented_code_data.is_active)
+    bool is_between_lines_state_active(LexerData const & lexer_data) noexcept
+    {
+        return lexer_data.commented_code_data.is_active ||
+            lexer_data.string_constant_data.is_active ||
+            lexer_data.preprocessor_directives_data.is_active;
+    }
+
+    void finish(LexerData & lexer_data) noexcept
+    {
+        CommonData & data = lexer_data.data;
+
+        if (lexer_data.commented_code_data.is_active)
         {
             create_new_token_error(
-                data.token_errors,
-                "Error, unfinished comment",
-                commented_code_data
+                data,
+                TokenErrorCode::UnfinishedCommentAtEnd,
+                lexer_data.commented_code_data
             );
         }
-        if (string_constant_data.is_active)
+        if (lexer_data.string_constant_data.is_active)
         {
             create_new_token_error(
-                data.token_errors,
-                "Error, unfinished string constant",
-                string_constant_data
+                data,
+                TokenErrorCode::UnfinishedStringConstantAtEnd,
+                lexer_data.string_constant_data
             );
         }
-        if (preprocessor_directives_data.is_active)
+        if (lexer_data.preprocessor_directives_data.is_active)
         {
             create_new_token_error(
-                data.token_errors,
-                "Error, unfinished preprocessor directives",
-                preprocessor_directives_data
+                data,
+                TokenErrorCode::UnfinishedPreprocessorDirectivesAtEnd,
+                lexer_data.preprocessor_directives_data
             );
         }
 
-        return { data.symbol_table, { data.tokens, data.token_errors } };
+        lexer_data.is_finished = true;
     }
 
-    void output_lexer_data(std::ostream & os, lexer_output_t const & lexer_output) noexcept
+
+    Lexer::Lexer() noexcept
+        : lexer_data{ std::make_unique<LexerData>() }
     {
-        lexer::symbol_table_t const & symbol_table = lexer_output.first;
-        lexer::tokens_t const & tokens = lexer_output.second.first;
-        lexer::token_errors_t const & token_errors = lexer_output.second.second;
 
-        if (token_errors.empty())
-        {
-            os << "No errors\n\n";
-        }
-        else
+    }
+
+    Lexer::~Lexer() noexcept = default;
+
+    Lexer::Lexer(Lexer &&) noexcept = default;
+    Lexer & Lexer::operator=(Lexer &&) noexcept = default;
+
+    bool Lexer::open(std::string const & file_path, LexerOptions const & options) noexcept
+    {
+        lexer_data = std::make_unique<LexerData>();
+        lexer_data->data.options = options;
+        return open_source_file(*lexer_data, file_path);
+    }
+
+    bool Lexer::open_code(std::string_view code, LexerOptions const & options) noexcept
+    {
+        lexer_data = std::make_unique<LexerData>();
+        lexer_data->data.options = options;
+        return set_source(*lexer_data, code, nullptr);
+    }
+
+    bool Lexer::fill() noexcept
+    {
+        tokens_t & tokens = lexer_data->data.tokens;
+
+        while (lexer_data->next_token_index >= tokens.size())
         {
-            os << "Error: " << token_errors.size() << '\n';
-            for (size_t i = 0; i < token_errors.size(); ++i)
+            tokens.clear();
+            lexer_data->next_token_index = 0;
+
+            if (lexer_data->is_finished)
             {
-                os << "Line: " << std::right << std::setw(4) << token_errors[i].line <<
-                    '[' << std::left << std::setw(4) << token_errors[i].column << ']' << ' ';
-                os << std::setw(50) << token_errors[i].message << ' ';
-                os << "Symbol: " << std::setw(0) << '|' << token_errors[i].symbol << '|';
-                os << '\n';
+                return false;
             }
-            os << '\n';
-        }
 
-        os << "Tokens:\n";
-        for (size_t i = 0; i < tokens.size(); ++i)
-        {
-            os << std::left;
-            os << "( " << std::setw(15) << Token_to_string[static_cast<size_t>(tokens[i].type)] << ' ';
-            if (is_symbol_type(tokens[i].type))
+            if (!lexer_data->is_line_active)
             {
-                os << ", " << std::setw(4) << std::to_string(tokens[i].index_in_symbol_table) << " )";
+                if (!next_line(*lexer_data))
+                {
+                    finish(*lexer_data);
+                    continue;
+                }
+                lexer_data->is_line_active = true;
             }
-            else
+
+            if (!next_token(*lexer_data))
             {
-                os << "       )";
+                lexer_data->is_line_active = false;
             }
-
-            os << '\n';
         }
-        os << '\n';
 
+        return true;
+    }
 
-        os << "Symbol table:\n";
-        for (size_t i = 0; i < symbol_table.size(); ++i)
+    std::pair<Token, bool> Lexer::peek() noexcept
+    {
+        if (!fill())
         {
-            os << std::left;
-            os << "Index: " << std::setw(3) << i << ' ';
-            os << "Symbol: " << std::setw(0) << '|' << symbol_table[i] << '|';
-            os << '\n';
+            return { Token{ 0, TokenType::Invalid }, false };
         }
-        os << '\n';
+        return { lexer_data->data.tokens[lexer_data->next_token_index], true };
+    }
 
-        os << "Tokens (full info):\n";
-        for (size_t i = 0; i < tokens.size(); ++i)
+    std::pair<Token, bool> Lexer::next() noexcept
+    {
+        std::pair<Token, bool> const token = peek();
+        if (token.second)
         {
-            os << std::left;
-            os << "Id: " << std::setw(3) << i << ' ';
-            os << "Type: " << std::setw(15) << Token_to_string[static_cast<size_t>(tokens[i].type)] << ' ';
-            os << "Line: " << std::right << std::setw(4) << tokens[i].line <<
-                '[' << std::left << std::setw(4) << tokens[i].column << ']' << ' ';
-            if (is_symbol_type(tokens[i].type))
-            {
-                os << "Symbol id: " << std::setw(4) << std::to_string(tokens[i].index_in_symbol_table) << ' ';
-                os << "Symbol: " << std::setw(0) << '|' << symbol_table[tokens[i].index_in_symbol_table] << '|';
-            }
-            else
-            {
-                os << "Symbol id: " << std::setw(4) << "" << ' ';
-                os << "Symbol: " << std::setw(0);
-            }
+            ++lexer_data->next_token_index;
+        }
+        return token;
+    }
+
+    symbol_table_t const & Lexer::symbol_table() const noexcept
+    {
+        return lexer_data->data.symbol_table;
+    }
+
+    token_errors_t const & Lexer::token_errors() const noexcept
+    {
+        return lexer_data->data.token_errors;
+    }
+
+    LineIndex const & Lexer::line_index() const noexcept
+    {
+        return lexer_data->line_index;
+    }
+
+    std::string_view Lexer::source() const noexcept
+    {
+        return lexer_data->data.source;
+    }
 
-            os << '\n';
+    lexer_output_t get_tokens(std::string const & file_path, LexerOptions const & options) noexcept(!IS_DEBUG)
+    {
+        TraceSpan const file_span{ TracePhase::File, file_path };
+
+        LexerData lexer_data{};
+        lexer_data.data.options = options;
+
+        if (!open_source_file(lexer_data, file_path))
+        {
+            assert(false && "Cannot open file");
+            return {};
         }
+
+        TraceSpan const lex_span{ TracePhase::Lex };
+        return lex_source(lexer_data);
     }
-}
\ No newline at end of file
+}
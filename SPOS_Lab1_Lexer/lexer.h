@@ -3,6 +3,16 @@
 
 #include <vector>
 #include <string>
+#include <limits>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string_view>
+
+#include "symbol_table.h"
+#include "line_index.h"
 
 
 namespace lexer
@@ -344,21 +354,98 @@ namespace lexer
         "Invalid"
     };
 
+    // groups of token types, same as "* ..." sections of TokenType
+    enum class TokenCategory : uint8_t
+    {
+        NumericConstants,
+        Literals,
+        PreprocessorDirectives,
+        Comments,
+        Keywords,
+        Identifiers,
+        Operators,
+        PunctuationMarks,
+
+        CountOf
+    };
+
+    constexpr char const * Token_category_to_string[static_cast<uint8_t>(TokenCategory::CountOf)] =
+    {
+        "numeric_constants",
+        "literals",
+        "preprocessor_directives",
+        "comments",
+        "keywords",
+        "identifiers",
+        "operators",
+        "punctuation_marks"
+    };
+
+    constexpr TokenCategory get_token_category(TokenType type) noexcept
+    {
+        if (type < TokenType::NumericConstantsEnd)
+        {
+            return TokenCategory::NumericConstants;
+        }
+        if (type < TokenType::PreprocessorDirectivesBegin)
+        {
+            return TokenCategory::Literals;
+        }
+        if (type < TokenType::PreprocessorDirectivesEnd)
+        {
+            return TokenCategory::PreprocessorDirectives;
+        }
+        if (type < TokenType::KeywordsBegin)
+        {
+            return TokenCategory::Comments;
+        }
+        if (type < TokenType::KeywordsEnd)
+        {
+            return TokenCategory::Keywords;
+        }
+        if (type == TokenType::Id)
+        {
+            return TokenCategory::Identifiers;
+        }
+        if (type < TokenType::OperatorsEnd)
+        {
+            return TokenCategory::Operators;
+        }
+        return TokenCategory::PunctuationMarks;
+    }
+
+    // bitmask of categories, bit of category is 1 << category
+    using token_categories_t = uint32_t;
+
+    constexpr token_categories_t get_token_category_bit(TokenCategory category) noexcept
+    {
+        return token_categories_t{ 1 } << static_cast<uint8_t>(category);
+    }
+
+    constexpr token_categories_t all_token_categories = (token_categories_t{ 1 } << static_cast<uint8_t>(TokenCategory::CountOf)) - 1;
+
+    constexpr bool is_token_category_in(token_categories_t categories, TokenType type) noexcept
+    {
+        return (categories & get_token_category_bit(get_token_category(type))) != 0;
+    }
+
+    // offset is position of first byte of token in source,
+    // line and column are found through line index;
+    // symbol is exact source text of token: symbol of comment, string constant or directive
+    // that continues on next lines keeps its line breaks and \ continuations,
+    // so same string split over lines in other way is other symbol
     struct Token
     {
-        size_t line;
-        size_t column;
+        size_t offset;
         size_t index_in_symbol_table;
         TokenType type;
 
         Token(
-            size_t line,
-            size_t column,
+            size_t offset,
             TokenType type,
             size_t index_in_symbol_table = std::numeric_limits<size_t>::max()
         ) noexcept
-            : line{ line },
-            column{ column },
+            : offset{ offset },
             type{ type },
             index_in_symbol_table{ index_in_symbol_table }
         {
@@ -366,33 +453,435 @@ namespace lexer
         }
     };
 
+    // tokens are stored as separate arrays of 32 bit fields (9 bytes per token),
+    // Token is only a view that is built on access, sources over max_source_size are rejected
+    class TokenStore
+    {
+    public:
+        class const_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Token;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = Token;
+
+            const_iterator(TokenStore const * store, size_t index) noexcept
+                : store{ store },
+                index{ index }
+            {
+
+            }
+
+            Token operator*() const noexcept { return (*store)[index]; }
+            const_iterator & operator++() noexcept { ++index; return *this; }
+            const_iterator operator++(int) noexcept { const_iterator const old = *this; ++index; return old; }
+            bool operator==(const_iterator const & other) const noexcept { return index == other.index; }
+            bool operator!=(const_iterator const & other) const noexcept { return index != other.index; }
+
+        private:
+            TokenStore const * store;
+            size_t index;
+        };
+
+        void push_back(Token const & token) noexcept
+        {
+            assert(token.offset <= max_source_size && "Offset does not fit in 32 bits");
+            assert((token.index_in_symbol_table < no_index || token.index_in_symbol_table == std::numeric_limits<size_t>::max()) &&
+                "Symbol index does not fit in 32 bits");
+
+            types.push_back(token.type);
+            offsets.push_back(static_cast<uint32_t>(token.offset));
+            indices_in_symbol_table.push_back(
+                token.index_in_symbol_table == std::numeric_limits<size_t>::max() ?
+                no_index :
+                static_cast<uint32_t>(token.index_in_symbol_table)
+            );
+        }
+
+        // appends tokens of other store starting from index begin
+        void append(TokenStore const & other, size_t begin = 0) noexcept
+        {
+            types.insert(types.end(), other.types.begin() + begin, other.types.end());
+            offsets.insert(offsets.end(), other.offsets.begin() + begin, other.offsets.end());
+            indices_in_symbol_table.insert(
+                indices_in_symbol_table.end(),
+                other.indices_in_symbol_table.begin() + begin,
+                other.indices_in_symbol_table.end()
+            );
+        }
+
+        Token operator[](size_t index) const noexcept
+        {
+            return { offset(index), type(index), index_in_symbol_table(index) };
+        }
+
+        TokenType type(size_t index) const noexcept { return types[index]; }
+        size_t offset(size_t index) const noexcept { return offsets[index]; }
+        size_t line(size_t index) const noexcept { return lines.line(offsets[index]); }
+        size_t column(size_t index) const noexcept { return lines.column(offsets[index]); }
+        size_t index_in_symbol_table(size_t index) const noexcept
+        {
+            uint32_t const symbol_index = indices_in_symbol_table[index];
+            return (symbol_index == no_index ? std::numeric_limits<size_t>::max() : symbol_index);
+        }
+        // false for tokens of types without symbol and for tokens which symbols are not interned
+        bool has_symbol(size_t index) const noexcept { return indices_in_symbol_table[index] != no_index; }
+
+        void set_index_in_symbol_table(size_t index, size_t symbol_index) noexcept
+        {
+            assert(symbol_index < no_index && "Symbol index does not fit in 32 bits");
+            indices_in_symbol_table[index] = static_cast<uint32_t>(symbol_index);
+        }
+
+        // replaces tokens [begin, end) by all tokens of other
+        void splice(size_t begin, size_t end, TokenStore const & other) noexcept
+        {
+            splice_array(types, begin, end, other.types);
+            splice_array(offsets, begin, end, other.offsets);
+            splice_array(indices_in_symbol_table, begin, end, other.indices_in_symbol_table);
+        }
+
+        // moves tokens starting from index begin by delta bytes
+        void shift_offsets(size_t begin, std::ptrdiff_t delta) noexcept
+        {
+            for (size_t i = begin; i < offsets.size(); ++i)
+            {
+                std::ptrdiff_t const offset = static_cast<std::ptrdiff_t>(offsets[i]) + delta;
+                assert(offset >= 0 && static_cast<size_t>(offset) <= max_source_size && "Offset does not fit in 32 bits");
+                offsets[i] = static_cast<uint32_t>(offset);
+            }
+        }
+
+        size_t size() const noexcept { return types.size(); }
+        bool empty() const noexcept { return types.empty(); }
+
+        void reserve(size_t count) noexcept
+        {
+            types.reserve(count);
+            offsets.reserve(count);
+            indices_in_symbol_table.reserve(count);
+        }
+
+        void clear() noexcept
+        {
+            types.clear();
+            offsets.clear();
+            indices_in_symbol_table.clear();
+        }
+
+        // line index of source that tokens are from, clear() does not reset it
+        LineIndex const & line_index() const noexcept { return lines; }
+        LineIndex & line_index() noexcept { return lines; }
+        void set_line_index(LineIndex line_index) noexcept { lines = std::move(line_index); }
+
+        // source that tokens and errors are from, symbols of errors are its spans,
+        // owner keeps source alive (it may be empty if source outlives tokens), clear() does not reset it
+        std::string_view source() const noexcept { return source_text; }
+        void set_source(std::shared_ptr<void const> owner, std::string_view source) noexcept
+        {
+            source_owner = std::move(owner);
+            source_text = source;
+        }
+
+        const_iterator begin() const noexcept { return { this, 0 }; }
+        const_iterator end() const noexcept { return { this, size() }; }
+
+    private:
+        static constexpr uint32_t no_index = std::numeric_limits<uint32_t>::max();
+
+        template <typename T>
+        static void splice_array(std::vector<T> & array, size_t begin, size_t end, std::vector<T> const & other) noexcept
+        {
+            array.erase(array.begin() + begin, array.begin() + end);
+            array.insert(array.begin() + begin, other.begin(), other.end());
+        }
+
+        std::vector<TokenType> types{};
+        std::vector<uint32_t> offsets{};
+        std::vector<uint32_t> indices_in_symbol_table{};
+
+        LineIndex lines{};
+
+        std::shared_ptr<void const> source_owner{};
+        std::string_view source_text{};
+    };
+
+    enum class TokenErrorCode : uint8_t
+    {
+        DoubleDotInNumber,
+        NumberSeparatorAndDotTooClose,
+        NumberSeparatorsTooClose,
+        DotAndNumberSeparatorTooClose,
+        InvalidSymbolAfterNumber,
+        InvalidNumberEnd,
+
+        UnfinishedCharacter,
+        EmptyCharacterConstant,
+        UnfinishedCharacterSymbols,
+        TooManyCharactersInSymbolConstant,
+
+        UnfinishedStringConstant,
+        UndefinedPreprocessorDirectives,
+        InvalidOperator,
+        UnrecognizedSymbol,
+
+        // constructs that are not finished at the end of source
+        UnfinishedCommentAtEnd,
+        UnfinishedStringConstantAtEnd,
+        UnfinishedPreprocessorDirectivesAtEnd,
+
+        // last recorded error when errors count reaches LexerOptions::max_token_errors_count
+        TooManyErrors,
+
+        CountOf
+    };
+
+    constexpr char const * Token_error_code_to_string[static_cast<uint8_t>(TokenErrorCode::CountOf)] =
+    {
+        "Error: double dot in number value",
+        "Error: number separator and dot too close",
+        "Error: number separators too close",
+        "Error: dot and number separator too close",
+        "Error: invalid symbol after number",
+        "Error: invalid number end",
+
+        "Error: unfinished symbol: symbol on end of line",
+        "Error: empty character constant",
+        "Error: unfinished symbol: symbols on end of line",
+        "Error: too many characters in symbol constant",
+
+        "Error: unfinished string constant",
+        "Error: undefined preprocessor directives",
+        "Error: invalid operator",
+        "Error: symbol could not be recognized",
+
+        "Error, unfinished comment",
+        "Error, unfinished string constant",
+        "Error, unfinished preprocessor directives",
+
+        "Error: too many errors, next errors are not recorded"
+    };
+
+    // error is not formatted while lexing: message is found by code,
+    // symbol is span [symbol_offset, symbol_offset + length) of source that tokens are from,
+    // offset is where error is reported, it is not always start of symbol
     struct TokenError
     {
-        std::string message;
-        std::string symbol;
-        size_t line;
-        size_t column;
-        size_t length;
-
-        TokenError(std::string message, std::string symbol, size_t line, size_t column, size_t length) noexcept
-            : message{ message },
-            symbol{ symbol },
-            line{ line },
-            column{ column },
-            length{ length }
+        uint32_t offset;
+        uint32_t symbol_offset;
+        uint32_t length;
+        TokenErrorCode code;
+
+        TokenError(TokenErrorCode code, size_t offset, size_t symbol_offset, size_t length) noexcept
+            : offset{ static_cast<uint32_t>(offset) },
+            symbol_offset{ static_cast<uint32_t>(symbol_offset) },
+            length{ static_cast<uint32_t>(length) },
+            code{ code }
         {
+            assert(offset <= max_source_size && symbol_offset + length <= max_source_size && "Offset does not fit in 32 bits");
+        }
 
+        char const * message() const noexcept { return Token_error_code_to_string[static_cast<uint8_t>(code)]; }
+
+        std::string_view symbol(std::string_view source) const noexcept
+        {
+            return (symbol_offset > source.size() ? std::string_view{} : source.substr(symbol_offset, length));
         }
     };
 
+    struct LexerOptions
+    {
+        // errors after that many are not recorded, TooManyErrors error is recorded instead of first of them,
+        // so binary or wrong encoded file can not take memory by errors
+        size_t max_token_errors_count{ 1 << 16 };
+
+        // constructs of other categories are scanned over, but their tokens are not created
+        // and their symbols are not added to symbol table, errors in them are still recorded
+        token_categories_t token_categories{ all_token_categories };
+        // interning policy: tokens of other categories are created without symbol,
+        // so symbol table keeps only symbols that are needed (identifiers without comment bodies and so on)
+        token_categories_t interned_token_categories{ all_token_categories };
+    };
 
-    using symbol_table_t = std::vector<std::string>;
-    using tokens_t = std::vector<Token>;
+
+    using symbol_table_t = SymbolTable;
+    using tokens_t = TokenStore;
     using token_errors_t = std::vector<TokenError>;
 
     using lexer_output_t = std::pair<symbol_table_t, std::pair<tokens_t, token_errors_t>>;
 
-    lexer_output_t get_tokens(std::string const & file_path) noexcept(!IS_DEBUG);
+    struct LexerData;
+    class SourceFile;
+
+    // pull based lexer: tokens are produced on demand,
+    // memory does not grow with file size except symbol table, errors and line index
+    class Lexer
+    {
+    public:
+        Lexer() noexcept;
+        ~Lexer() noexcept;
+
+        Lexer(Lexer const &) = delete;
+        Lexer & operator=(Lexer const &) = delete;
+
+        Lexer(Lexer &&) noexcept;
+        Lexer & operator=(Lexer &&) noexcept;
+
+        // false if file could not be opened or it is bigger than max_source_size
+        bool open(std::string const & file_path, LexerOptions const & options = {}) noexcept;
+        // code must outlive lexer, false (and no tokens) if code is bigger than max_source_size
+        bool open_code(std::string_view code, LexerOptions const & options = {}) noexcept;
+
+        // second is false when there are no more tokens
+        std::pair<Token, bool> next() noexcept;
+        std::pair<Token, bool> peek() noexcept;
+
+        symbol_table_t const & symbol_table() const noexcept;
+        token_errors_t const & token_errors() const noexcept;
+        // lines that are read so far
+        LineIndex const & line_index() const noexcept;
+        // symbols of errors are spans of source
+        std::string_view source() const noexcept;
+
+    private:
+        bool fill() noexcept;
+
+        std::unique_ptr<LexerData> lexer_data;
+    };
+
+    // lexes many files one by one: buffers are cleared between files, but keep their capacity,
+    // so lexing does not allocate when files are not bigger than before,
+    // output is valid until next file is lexed
+    class LexerContext
+    {
+    public:
+        explicit LexerContext(LexerOptions const & options = {}) noexcept;
+        ~LexerContext() noexcept;
+
+        LexerContext(LexerContext const &) = delete;
+        LexerContext & operator=(LexerContext const &) = delete;
+
+        LexerContext(LexerContext &&) noexcept;
+        LexerContext & operator=(LexerContext &&) noexcept;
+
+        // false if file could not be opened or it is bigger than max_source_size, output is empty then
+        bool lex_file(std::string const & file_path) noexcept;
+        // code must outlive output
+        bool lex_code(std::string_view code) noexcept;
+
+        symbol_table_t const & symbol_table() const noexcept;
+        // line and column of tokens and errors are in line index of tokens
+        tokens_t const & tokens() const noexcept;
+        token_errors_t const & token_errors() const noexcept;
+
+    private:
+        bool lex(std::string_view source) noexcept;
+
+        std::unique_ptr<LexerData> lexer_data;
+        std::unique_ptr<SourceFile> source_file;
+    };
+
+    // keeps edited code with its tokens: edit relexes lines starting from last line
+    // before edit that is outside of comment, string constant and directives,
+    // until lexing reaches old line that starts in same state, other tokens are only moved,
+    // symbols of removed tokens stay in symbol table
+    class IncrementalLexer
+    {
+    public:
+        // max_token_errors_count is applied to errors of whole code after every edit
+        explicit IncrementalLexer(LexerOptions const & options = {}) noexcept
+            : options{ options }
+        {
+        }
+        ~IncrementalLexer() noexcept = default;
+
+        // source of tokens is pointed to own code again
+        IncrementalLexer(IncrementalLexer const & other) noexcept;
+        IncrementalLexer & operator=(IncrementalLexer const & other) noexcept;
+        IncrementalLexer(IncrementalLexer && other) noexcept;
+        IncrementalLexer & operator=(IncrementalLexer && other) noexcept;
+
+        // code bigger than max_source_size is not opened
+        bool open_code(std::string code) noexcept;
+        // replaces [begin, end) of code by text, false and nothing is changed
+        // if range is not inside code or edit makes code bigger than max_source_size
+        bool edit(size_t begin, size_t end, std::string_view text) noexcept;
+
+        std::string const & code() const noexcept { return source; }
+
+        symbol_table_t const & symbol_table() const noexcept { return symbols; }
+        // line and column of tokens and errors are in line index of tokens
+        tokens_t const & tokens() const noexcept { return token_store; }
+        token_errors_t const & token_errors() const noexcept { return errors; }
+
+    private:
+        LexerOptions options{};
+
+        std::string source{};
+
+        symbol_table_t symbols{};
+        tokens_t token_store{};
+        // all errors, edits move them, errors are capped copy of them
+        token_errors_t all_errors{};
+        token_errors_t errors{};
+
+        // true if line starts outside of comment, string constant and directives
+        std::vector<bool> is_line_clean{};
+    };
+
+    lexer_output_t get_tokens(std::string const & file_path, LexerOptions const & options = {}) noexcept(!IS_DEBUG);
+
+    // lexes big file in chunks on several threads, output is same as from get_tokens,
+    // threads_count = 0 means number of hardware threads
+    lexer_output_t get_tokens_parallel(
+        std::string const & file_path,
+        size_t threads_count = 0,
+        LexerOptions const & options = {}
+    ) noexcept(!IS_DEBUG);
+
+    struct BatchLexerOutput
+    {
+        // same order as file paths, indices in tokens are in own symbol table of file
+        std::vector<lexer_output_t> files{};
+
+        // filled only if global symbol table is requested
+        symbol_table_t symbol_table{};
+        // index in symbol table of file -> index in global symbol table
+        std::vector<std::vector<size_t>> file_to_global_symbol_indices{};
+    };
+
+    // lexes files on thread pool, output does not depend on scheduling,
+    // threads_count = 0 means number of hardware threads
+    BatchLexerOutput get_tokens_batch(
+        std::vector<std::string> const & file_paths,
+        bool is_global_symbol_table_needed = false,
+        size_t threads_count = 0,
+        LexerOptions const & options = {}
+    ) noexcept(!IS_DEBUG);
+
+    enum class OutputFormat : uint8_t
+    {
+        // human readable tables, one line per row: line breaks in symbols are written as \n and \r
+        Text,
+        // one json object per line, "kind" is error, token or symbol
+        JsonLines,
+        // one table with columns kind,id,type,line,column,offset,length,symbol_id,symbol,message
+        Csv
+    };
+
+    struct OutputOptions
+    {
+        OutputFormat format{ OutputFormat::Text };
+
+        bool is_errors_needed{ true };
+        bool is_tokens_needed{ true };
+        bool is_symbol_table_needed{ true };
+        // in json lines and csv both token sections are written once as full info records
+        bool is_tokens_full_info_needed{ true };
+    };
 
-    void output_lexer_data(std::ostream & os, lexer_output_t const & lexer_output) noexcept;
+    // output is built in big blocks, stream is written once per block
+    void output_lexer_data(std::ostream & os, lexer_output_t const & lexer_output, OutputOptions const & options = {}) noexcept;
 }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "lexer.h"
+#include "lexer_internal.h"
+#include "trace.h"
+
+
+namespace lexer
+{
+    LexerContext::LexerContext(LexerOptions const & options) noexcept
+        : lexer_data{ std::make_unique<LexerData>() },
+        source_file{ std::make_unique<SourceFile>() }
+    {
+        lexer_data->data.options = options;
+    }
+
+    LexerContext::~LexerContext() noexcept = default;
+
+    LexerContext::LexerContext(LexerContext &&) noexcept = default;
+    LexerContext & LexerContext::operator=(LexerContext &&) noexcept = default;
+
+    bool LexerContext::lex_file(std::string const & file_path) noexcept
+    {
+        TraceSpan const file_span{ TracePhase::File, file_path };
+
+        if (!source_file->open(file_path))
+        {
+            lex({});
+            return false;
+        }
+
+        TraceSpan const lex_span{ TracePhase::Lex };
+        // symbols are views into source file that is kept until next file
+        return lex(source_file->text());
+    }
+
+    bool LexerContext::lex_code(std::string_view code) noexcept
+    {
+        source_file->close();
+        return lex(code);
+    }
+
+    bool LexerContext::lex(std::string_view source) noexcept
+    {
+        LexerData & data = *lexer_data;
+
+        // line index of previous output is taken back, so its buffer is reused too
+        data.line_index = std::move(data.data.tokens.line_index());
+        data.line_index.clear();
+
+        data.data.symbol_table.clear();
+        data.data.tokens.clear();
+        data.data.token_errors.clear();
+        data.data.token_errors_begin = 0;
+        data.data.code = {};
+        data.data.line_offset = 0;
+        data.data.column = 0;
+
+        data.next_line_begin = 0;
+        data.commented_code_data = {};
+        data.string_constant_data = {};
+        data.preprocessor_directives_data = {};
+        data.is_line_active = false;
+        data.is_finished = false;
+        data.next_token_index = 0;
+
+        bool const is_source_set = set_source(data, source, nullptr);
+        reserve_for_source(data);
+        lex_whole_source(data);
+        return is_source_set;
+    }
+
+    symbol_table_t const & LexerContext::symbol_table() const noexcept
+    {
+        return lexer_data->data.symbol_table;
+    }
+
+    tokens_t const & LexerContext::tokens() const noexcept
+    {
+        return lexer_data->data.tokens;
+    }
+
+    token_errors_t const & LexerContext::token_errors() const noexcept
+    {
+        return lexer_data->data.token_errors;
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+
+#include "lexer.h"
+#include "source_file.h"
+
+
+// lexer state shared between lexer translation units
+namespace lexer
+{
+    struct CommonData
+    {
+        symbol_table_t symbol_table{};
+        tokens_t tokens{};
+        token_errors_t token_errors{};
+        // max_token_errors_count limits errors after this index,
+        // speculative chunk lexing moves it to every checkpoint
+        size_t token_errors_begin{ 0 };
+        // whole source, begins at offset 0
+        std::string_view source{};
+        // current line and its offset in source
+        std::string_view code{};
+        size_t line_offset{ 0 };
+        size_t column{ 0 };
+
+        LexerOptions options{};
+    };
+
+    // construct that continues on next lines: span [begin, end) of source
+    // that grows with every not blank line, text is never copied,
+    // token symbol is exact source text of span
+    struct BetweenLinesData
+    {
+        size_t begin{ 0 };
+        size_t end{ 0 };
+        bool is_active{ false };
+        TokenType type{ TokenType::Invalid };
+    };
+
+    struct LexerData
+    {
+        // shared with symbol table that keeps views into source
+        std::shared_ptr<SourceFile> source_file{};
+        size_t next_line_begin{ 0 };
+        LineIndex line_index{};
+
+        CommonData data{};
+
+        BetweenLinesData commented_code_data{};
+        BetweenLinesData string_constant_data{};
+        BetweenLinesData preprocessor_directives_data{};
+
+        // true while data.code is line that is not fully lexed yet
+        bool is_line_active{ false };
+        bool is_finished{ false };
+
+        // first token in data.tokens that is not returned by Lexer yet
+        size_t next_token_index{ 0 };
+    };
+
+
+    bool is_symbol_type(TokenType type) noexcept;
+
+    bool next_token(
+        CommonData & data,
+        BetweenLinesData & commented_code_data,
+        BetweenLinesData & string_constant_data,
+        BetweenLinesData & preprocessor_directives_data
+    ) noexcept;
+
+    // symbols that are views into source and symbols of errors keep source_owner alive,
+    // empty owner means that source outlives lexer output
+    // source bigger than max_source_size is not set (empty source is set instead), false then
+    bool set_source(LexerData & lexer_data, std::string_view source, std::shared_ptr<void const> source_owner) noexcept;
+    bool open_source_file(LexerData & lexer_data, std::string const & file_path) noexcept;
+    // grows tokens and line index of source that is set to estimated size at once
+    void reserve_for_source(LexerData & lexer_data) noexcept;
+    // lexes whole source that is set, line index is moved to tokens
+    void lex_whole_source(LexerData & lexer_data) noexcept;
+    lexer_output_t lex_source(LexerData & lexer_data) noexcept;
+    // cuts errors that were recorded without limit as lexing with max_token_errors_count would,
+    // for lexers that join errors of several parts of source
+    void cap_token_errors(token_errors_t & token_errors, size_t max_token_errors_count) noexcept;
+
+    // how get_tokens_parallel splits source, checks use small sizes to get many chunks from small files
+    struct ParallelLexingTuning
+    {
+        // smaller files are not worth splitting
+        size_t min_chunk_size{ 1 << 20 };
+        // how often chunk remembers position where it could be joined with fixed previous chunk
+        size_t checkpoint_lines_step{ 64 };
+    };
+
+    lexer_output_t get_tokens_parallel(
+        std::string const & file_path,
+        size_t threads_count,
+        LexerOptions const & options,
+        ParallelLexingTuning const & tuning
+    ) noexcept(!IS_DEBUG);
+
+    // one hash and one compare: perfect hash tables are generated from Token_to_string
+    std::pair<TokenType, bool> try_get_keywords(std::string_view word) noexcept;
+    std::pair<TokenType, bool> try_get_preprocessor_directives(std::string_view word) noexcept;
+
+    // sets data.code to next line of source, false on end of source
+    bool next_line(LexerData & lexer_data) noexcept;
+    bool next_token(LexerData & lexer_data) noexcept;
+    // lexes current line to the end
+    void lex_line(LexerData & lexer_data) noexcept;
+    // true if lexer is inside comment, string constant or preprocessor directives
+    bool is_between_lines_state_active(LexerData const & lexer_data) noexcept;
+    // reports constructs that are not finished at the end of source
+    void finish(LexerData & lexer_data) noexcept;
+}
@@ -0,0 +1,47 @@
+#include "line_index.h"
+
+#include <algorithm>
+
+
+namespace lexer
+{
+    void LineIndex::append(LineIndex const & other) noexcept
+    {
+        line_begins.insert(line_begins.end(), other.line_begins.begin(), other.line_begins.end());
+    }
+
+    void LineIndex::splice(size_t begin, size_t end, LineIndex const & other) noexcept
+    {
+        line_begins.erase(line_begins.begin() + begin, line_begins.begin() + end);
+        line_begins.insert(line_begins.begin() + begin, other.line_begins.begin(), other.line_begins.end());
+    }
+
+    void LineIndex::shift(size_t begin, std::ptrdiff_t delta) noexcept
+    {
+        for (size_t i = begin; i < line_begins.size(); ++i)
+        {
+            std::ptrdiff_t const line_begin = static_cast<std::ptrdiff_t>(line_begins[i]) + delta;
+            assert(line_begin >= 0 && static_cast<size_t>(line_begin) <= max_source_size && "Offset does not fit in 32 bits");
+            line_begins[i] = static_cast<uint32_t>(line_begin);
+        }
+    }
+
+    size_t LineIndex::line(size_t offset) const noexcept
+    {
+        auto const next_line = std::upper_bound(line_begins.begin(), line_begins.end(), offset);
+        if (next_line == line_begins.begin())
+        {
+            return 0;
+        }
+        return static_cast<size_t>(next_line - line_begins.begin()) - 1;
+    }
+
+    size_t LineIndex::column(size_t offset) const noexcept
+    {
+        if (line_begins.empty())
+        {
+            return offset;
+        }
+        return offset - line_begin(line(offset));
+    }
+}
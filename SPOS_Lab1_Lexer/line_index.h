@@ -0,0 +1,48 @@
+#pragma once
+
+
+#include <vector>
+#include <limits>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace lexer
+{
+    // offsets in line index, tokens and errors are 32 bit,
+    // so bigger sources are rejected when they are opened or set
+    constexpr size_t max_source_size = std::numeric_limits<uint32_t>::max();
+
+    // byte offsets where lines of source begin, filled while source is scanned,
+    // line and column of offset are found by binary search
+    class LineIndex
+    {
+    public:
+        // offsets must be added in increasing order
+        void push_line(size_t line_begin) noexcept
+        {
+            assert(line_begin <= max_source_size && "Offset does not fit in 32 bits");
+            line_begins.push_back(static_cast<uint32_t>(line_begin));
+        }
+        void append(LineIndex const & other) noexcept;
+        // replaces lines [begin, end) by all lines of other
+        void splice(size_t begin, size_t end, LineIndex const & other) noexcept;
+        // moves lines starting from line begin by delta bytes
+        void shift(size_t begin, std::ptrdiff_t delta) noexcept;
+
+        // lines and columns start from 0
+        size_t line(size_t offset) const noexcept;
+        size_t column(size_t offset) const noexcept;
+        size_t line_begin(size_t line) const noexcept { return line_begins[line]; }
+
+        void clear() noexcept { line_begins.clear(); }
+        void reserve(size_t count) noexcept { line_begins.reserve(count); }
+
+        size_t size() const noexcept { return line_begins.size(); }
+        bool empty() const noexcept { return line_begins.empty(); }
+
+    private:
+        std::vector<uint32_t> line_begins{};
+    };
+}
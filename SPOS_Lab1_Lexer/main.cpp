@@ -1,4 +1,5 @@
 #include "lexer.h"
+#include "instrumentation.h"
 
 #include <iostream>
 
@@ -8,4 +9,9 @@ int main()
     lexer::lexer_output_t const lexer_output = lexer::get_tokens("code.txt");
     
     lexer::output_lexer_data(std::cout, lexer_output);
+
+    if (lexer::is_instrumentation_enabled)
+    {
+        lexer::output_instrumentation_report(std::cerr, lexer::get_instrumentation_report());
+    }
 }
\ No newline at end of file
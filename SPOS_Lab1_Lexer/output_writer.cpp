@@ -0,0 +1,479 @@
+#include "lexer.h"
+#include "lexer_internal.h"
+#include "trace.h"
+
+#include <ostream>
+#include <charconv>
+#include <cstring>
+#include <array>
+
+
+namespace lexer
+{
+    namespace
+    {
+        // output is collected into big block that is written to stream when it is full
+        class OutputBuffer
+        {
+        public:
+            explicit OutputBuffer(std::ostream & os) noexcept
+                : os{ os }
+            {
+
+            }
+
+            ~OutputBuffer() noexcept
+            {
+                flush();
+            }
+
+            OutputBuffer(OutputBuffer const &) = delete;
+            OutputBuffer & operator=(OutputBuffer const &) = delete;
+
+            void put(char symbol) noexcept
+            {
+                if (used == buffer.size())
+                {
+                    flush();
+                }
+                buffer[used++] = symbol;
+            }
+
+            void put(std::string_view text) noexcept
+            {
+                if (text.size() > buffer.size() - used)
+                {
+                    flush();
+                    if (text.size() > buffer.size())
+                    {
+                        os.write(text.data(), static_cast<std::streamsize>(text.size()));
+                        return;
+                    }
+                }
+                std::memcpy(buffer.data() + used, text.data(), text.size());
+                used += text.size();
+            }
+
+            void put_spaces(size_t count) noexcept
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    put(' ');
+                }
+            }
+
+            // same as std::setw with std::left or std::right
+            void put_padded(std::string_view text, size_t width, bool is_right_aligned = false) noexcept
+            {
+                size_t const padding = (text.size() < width ? width - text.size() : 0);
+                if (is_right_aligned)
+                {
+                    put_spaces(padding);
+                }
+                put(text);
+                if (!is_right_aligned)
+                {
+                    put_spaces(padding);
+                }
+            }
+
+            void put_number(size_t value, size_t width = 0, bool is_right_aligned = false) noexcept
+            {
+                char digits[20]{};
+                char * const end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+                put_padded({ digits, static_cast<size_t>(end - digits) }, width, is_right_aligned);
+            }
+
+            void put_json_string(std::string_view text) noexcept
+            {
+                constexpr char hex_digits[] = "0123456789abcdef";
+
+                put('"');
+                size_t run_begin = 0;
+                for (size_t i = 0; i < text.size(); ++i)
+                {
+                    unsigned char const symbol = static_cast<unsigned char>(text[i]);
+                    if (symbol >= 0x20 && symbol != '"' && symbol != '\\')
+                    {
+                        continue;
+                    }
+
+                    put(text.substr(run_begin, i - run_begin));
+                    run_begin = i + 1;
+                    switch (symbol)
+                    {
+                    case '"': put("\\\""); break;
+                    case '\\': put("\\\\"); break;
+                    case '\n': put("\\n"); break;
+                    case '\r': put("\\r"); break;
+                    case '\t': put("\\t"); break;
+                    default:
+                        put("\\u00");
+                        put(hex_digits[symbol >> 4]);
+                        put(hex_digits[symbol & 0xf]);
+                        break;
+                    }
+                }
+                put(text.substr(run_begin));
+                put('"');
+            }
+
+            // symbols of comments, string constants and directives that continue on next lines
+            // keep their line breaks, they are written as \n and \r, so every row stays one line
+            void put_text_symbol(std::string_view text) noexcept
+            {
+                put('|');
+                size_t run_begin = 0;
+                for (size_t i = 0; i < text.size(); ++i)
+                {
+                    if (text[i] != '\n' && text[i] != '\r')
+                    {
+                        continue;
+                    }
+
+                    put(text.substr(run_begin, i - run_begin));
+                    put(text[i] == '\n' ? "\\n" : "\\r");
+                    run_begin = i + 1;
+                }
+                put(text.substr(run_begin));
+                put('|');
+            }
+
+            // always quoted, quotes inside are doubled
+            void put_csv_string(std::string_view text) noexcept
+            {
+                put('"');
+                size_t run_begin = 0;
+                for (size_t quote = text.find('"'); quote != std::string_view::npos; quote = text.find('"', quote + 1))
+                {
+                    put(text.substr(run_begin, quote + 1 - run_begin));
+                    put('"');
+                    run_begin = quote + 1;
+                }
+                put(text.substr(run_begin));
+                put('"');
+            }
+
+            void flush() noexcept
+            {
+                os.write(buffer.data(), static_cast<std::streamsize>(used));
+                used = 0;
+            }
+
+        private:
+            static constexpr size_t buffer_size = 1 << 20;
+
+            std::ostream & os;
+            std::vector<char> buffer = std::vector<char>(buffer_size);
+            size_t used{ 0 };
+        };
+
+        // line of every next offset without binary search, offsets must not decrease
+        class LineCursor
+        {
+        public:
+            explicit LineCursor(LineIndex const & line_index) noexcept
+                : line_index{ line_index }
+            {
+
+            }
+
+            void advance(size_t offset) noexcept
+            {
+                while (line + 1 < line_index.size() && line_index.line_begin(line + 1) <= offset)
+                {
+                    ++line;
+                }
+                column = (line_index.empty() ? offset : offset - line_index.line_begin(line));
+            }
+
+            size_t line{ 0 };
+            size_t column{ 0 };
+
+        private:
+            LineIndex const & line_index;
+        };
+
+        // Token_to_string with lengths computed once
+        std::string_view type_name(TokenType type) noexcept
+        {
+            static auto const names = []()
+                {
+                    std::array<std::string_view, static_cast<size_t>(TokenType::CountOf)> names{};
+                    for (size_t i = 0; i < names.size(); ++i)
+                    {
+                        names[i] = Token_to_string[i];
+                    }
+                    return names;
+                }();
+            return names[static_cast<size_t>(type)];
+        }
+
+        void output_text(OutputBuffer & buffer, lexer_output_t const & lexer_output, OutputOptions const & options) noexcept
+        {
+            symbol_table_t const & symbol_table = lexer_output.first;
+            tokens_t const & tokens = lexer_output.second.first;
+            token_errors_t const & token_errors = lexer_output.second.second;
+            LineIndex const & line_index = tokens.line_index();
+            // symbols of errors are spans of it
+            std::string_view const source = tokens.source();
+
+            if (options.is_errors_needed)
+            {
+                if (token_errors.empty())
+                {
+                    buffer.put("No errors\n\n");
+                }
+                else
+                {
+                    buffer.put("Error: ");
+                    buffer.put_number(token_errors.size());
+                    buffer.put('\n');
+                    for (TokenError const & token_error : token_errors)
+                    {
+                        buffer.put("Line: ");
+                        buffer.put_number(line_index.line(token_error.offset), 4, true);
+                        buffer.put('[');
+                        buffer.put_number(line_index.column(token_error.offset), 4);
+                        buffer.put("] ");
+                        buffer.put_padded(token_error.message(), 50);
+                        buffer.put(" Symbol: ");
+                        buffer.put_text_symbol(token_error.symbol(source));
+                        buffer.put('\n');
+                    }
+                    buffer.put('\n');
+                }
+            }
+
+            if (options.is_tokens_needed)
+            {
+                buffer.put("Tokens:\n");
+                for (size_t i = 0; i < tokens.size(); ++i)
+                {
+                    buffer.put("( ");
+                    buffer.put_padded(type_name(tokens.type(i)), 15);
+                    buffer.put(' ');
+                    if (tokens.has_symbol(i))
+                    {
+                        buffer.put(", ");
+                        buffer.put_number(tokens.index_in_symbol_table(i), 4);
+                        buffer.put(" )\n");
+                    }
+                    else
+                    {
+                        buffer.put("       )\n");
+                    }
+                }
+                buffer.put('\n');
+            }
+
+            if (options.is_symbol_table_needed)
+            {
+                buffer.put("Symbol table:\n");
+                for (size_t i = 0; i < symbol_table.size(); ++i)
+                {
+                    buffer.put("Index: ");
+                    buffer.put_number(i, 3);
+                    buffer.put(" Symbol: ");
+                    buffer.put_text_symbol(symbol_table[i]);
+                    buffer.put('\n');
+                }
+                buffer.put('\n');
+            }
+
+            if (options.is_tokens_full_info_needed)
+            {
+                buffer.put("Tokens (full info):\n");
+                LineCursor cursor{ line_index };
+                for (size_t i = 0; i < tokens.size(); ++i)
+                {
+                    cursor.advance(tokens.offset(i));
+
+                    buffer.put("Id: ");
+                    buffer.put_number(i, 3);
+                    buffer.put(" Type: ");
+                    buffer.put_padded(type_name(tokens.type(i)), 15);
+                    buffer.put(" Line: ");
+                    buffer.put_number(cursor.line, 4, true);
+                    buffer.put('[');
+                    buffer.put_number(cursor.column, 4);
+                    buffer.put("] ");
+                    if (tokens.has_symbol(i))
+                    {
+                        buffer.put("Symbol id: ");
+                        buffer.put_number(tokens.index_in_symbol_table(i), 4);
+                        buffer.put(" Symbol: ");
+                        buffer.put_text_symbol(symbol_table[tokens.index_in_symbol_table(i)]);
+                        buffer.put('\n');
+                    }
+                    else
+                    {
+                        buffer.put("Symbol id:      Symbol: \n");
+                    }
+                }
+            }
+        }
+
+        void output_json_lines(OutputBuffer & buffer, lexer_output_t const & lexer_output, OutputOptions const & options) noexcept
+        {
+            symbol_table_t const & symbol_table = lexer_output.first;
+            tokens_t const & tokens = lexer_output.second.first;
+            token_errors_t const & token_errors = lexer_output.second.second;
+            LineIndex const & line_index = tokens.line_index();
+            // symbols of errors are spans of it
+            std::string_view const source = tokens.source();
+
+            if (options.is_errors_needed)
+            {
+                for (TokenError const & token_error : token_errors)
+                {
+                    buffer.put("{\"kind\":\"error\",\"line\":");
+                    buffer.put_number(line_index.line(token_error.offset));
+                    buffer.put(",\"column\":");
+                    buffer.put_number(line_index.column(token_error.offset));
+                    buffer.put(",\"offset\":");
+                    buffer.put_number(token_error.offset);
+                    buffer.put(",\"length\":");
+                    buffer.put_number(token_error.length);
+                    buffer.put(",\"message\":");
+                    buffer.put_json_string(token_error.message());
+                    buffer.put(",\"symbol\":");
+                    buffer.put_json_string(token_error.symbol(source));
+                    buffer.put("}\n");
+                }
+            }
+
+            if (options.is_tokens_needed || options.is_tokens_full_info_needed)
+            {
+                LineCursor cursor{ line_index };
+                for (size_t i = 0; i < tokens.size(); ++i)
+                {
+                    cursor.advance(tokens.offset(i));
+
+                    buffer.put("{\"kind\":\"token\",\"id\":");
+                    buffer.put_number(i);
+                    buffer.put(",\"type\":\"");
+                    buffer.put(type_name(tokens.type(i)));
+                    buffer.put("\",\"line\":");
+                    buffer.put_number(cursor.line);
+                    buffer.put(",\"column\":");
+                    buffer.put_number(cursor.column);
+                    buffer.put(",\"offset\":");
+                    buffer.put_number(tokens.offset(i));
+                    if (tokens.has_symbol(i))
+                    {
+                        buffer.put(",\"symbol_id\":");
+                        buffer.put_number(tokens.index_in_symbol_table(i));
+                    }
+                    buffer.put("}\n");
+                }
+            }
+
+            if (options.is_symbol_table_needed)
+            {
+                for (size_t i = 0; i < symbol_table.size(); ++i)
+                {
+                    buffer.put("{\"kind\":\"symbol\",\"id\":");
+                    buffer.put_number(i);
+                    buffer.put(",\"symbol\":");
+                    buffer.put_json_string(symbol_table[i]);
+                    buffer.put("}\n");
+                }
+            }
+        }
+
+        void output_csv(OutputBuffer & buffer, lexer_output_t const & lexer_output, OutputOptions const & options) noexcept
+        {
+            symbol_table_t const & symbol_table = lexer_output.first;
+            tokens_t const & tokens = lexer_output.second.first;
+            token_errors_t const & token_errors = lexer_output.second.second;
+            LineIndex const & line_index = tokens.line_index();
+            // symbols of errors are spans of it
+            std::string_view const source = tokens.source();
+
+            buffer.put("kind,id,type,line,column,offset,length,symbol_id,symbol,message\n");
+
+            if (options.is_errors_needed)
+            {
+                for (size_t i = 0; i < token_errors.size(); ++i)
+                {
+                    TokenError const & token_error = token_errors[i];
+                    buffer.put("error,");
+                    buffer.put_number(i);
+                    buffer.put(",,");
+                    buffer.put_number(line_index.line(token_error.offset));
+                    buffer.put(',');
+                    buffer.put_number(line_index.column(token_error.offset));
+                    buffer.put(',');
+                    buffer.put_number(token_error.offset);
+                    buffer.put(',');
+                    buffer.put_number(token_error.length);
+                    buffer.put(",,");
+                    buffer.put_csv_string(token_error.symbol(source));
+                    buffer.put(',');
+                    buffer.put_csv_string(token_error.message());
+                    buffer.put('\n');
+                }
+            }
+
+            if (options.is_tokens_needed || options.is_tokens_full_info_needed)
+            {
+                LineCursor cursor{ line_index };
+                for (size_t i = 0; i < tokens.size(); ++i)
+                {
+                    cursor.advance(tokens.offset(i));
+
+                    buffer.put("token,");
+                    buffer.put_number(i);
+                    buffer.put(',');
+                    // operator and punctuation names like , are quoted too
+                    buffer.put_csv_string(type_name(tokens.type(i)));
+                    buffer.put(',');
+                    buffer.put_number(cursor.line);
+                    buffer.put(',');
+                    buffer.put_number(cursor.column);
+                    buffer.put(',');
+                    buffer.put_number(tokens.offset(i));
+                    buffer.put(",,");
+                    if (tokens.has_symbol(i))
+                    {
+                        buffer.put_number(tokens.index_in_symbol_table(i));
+                    }
+                    buffer.put(",,\n");
+                }
+            }
+
+            if (options.is_symbol_table_needed)
+            {
+                for (size_t i = 0; i < symbol_table.size(); ++i)
+                {
+                    buffer.put("symbol,");
+                    buffer.put_number(i);
+                    buffer.put(",,,,,,,");
+                    buffer.put_csv_string(symbol_table[i]);
+                    buffer.put(",\n");
+                }
+            }
+        }
+    }
+
+    void output_lexer_data(std::ostream & os, lexer_output_t const & lexer_output, OutputOptions const & options) noexcept
+    {
+        TraceSpan const output_span{ TracePhase::Output };
+
+        OutputBuffer buffer{ os };
+
+        switch (options.format)
+        {
+        case OutputFormat::Text:
+            output_text(buffer, lexer_output, options);
+            break;
+        case OutputFormat::JsonLines:
+            output_json_lines(buffer, lexer_output, options);
+            break;
+        case OutputFormat::Csv:
+            output_csv(buffer, lexer_output, options);
+            break;
+        }
+    }
+}
@@ -0,0 +1,368 @@
+#include "lexer.h"
+#include "lexer_internal.h"
+#include "trace.h"
+
+#include <cassert>
+#include <thread>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+
+namespace lexer
+{
+    namespace
+    {
+        struct Checkpoint
+        {
+            // offset of next line
+            size_t offset;
+            size_t tokens_count;
+            size_t token_errors_count;
+        };
+
+        struct Chunk
+        {
+            size_t begin{ 0 };
+            size_t end{ 0 };
+
+            LexerData lexer_data{};
+
+            // lines where speculative lexing was not inside comment, string constant or directives
+            std::vector<Checkpoint> checkpoints{};
+        };
+
+        template <typename Function>
+        void parallel_for(size_t count, size_t threads_count, Function const & function) noexcept
+        {
+            std::vector<std::thread> threads{};
+            threads.reserve(threads_count);
+
+            for (size_t thread_index = 0; thread_index < threads_count; ++thread_index)
+            {
+                threads.emplace_back([&function, count, threads_count, thread_index]()
+                    {
+                        for (size_t i = thread_index; i < count; i += threads_count)
+                        {
+                            function(i);
+                        }
+                    });
+            }
+
+            for (std::thread & thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        std::vector<Chunk> split_to_chunks(std::string_view source, size_t chunks_count) noexcept
+        {
+            std::vector<Chunk> chunks{};
+            chunks.reserve(chunks_count);
+
+            size_t const chunk_size = source.size() / chunks_count;
+            size_t begin = 0;
+
+            while (begin < source.size())
+            {
+                size_t end = source.size();
+                if (chunks.size() + 1 < chunks_count && begin + chunk_size < source.size())
+                {
+                    // chunk always ends on line end
+                    size_t const line_end = source.find('\n', begin + chunk_size);
+                    if (line_end != std::string_view::npos)
+                    {
+                        end = line_end + 1;
+                    }
+                }
+
+                chunks.emplace_back();
+                chunks.back().begin = begin;
+                chunks.back().end = end;
+                begin = end;
+            }
+
+            return chunks;
+        }
+
+        void start_chunk_lexing(
+            LexerData & lexer_data,
+            std::shared_ptr<SourceFile> const & source_file,
+            Chunk const & chunk,
+            LexerOptions const & options
+        ) noexcept
+        {
+            lexer_data.data.options = options;
+            lexer_data.source_file = source_file;
+            set_source(lexer_data, source_file->text().substr(0, chunk.end), source_file);
+            lexer_data.next_line_begin = chunk.begin;
+        }
+
+        // lexes chunk as if it starts outside of any comment, string constant or directives
+        void lex_chunk_speculatively(
+            std::shared_ptr<SourceFile> const & source_file,
+            Chunk & chunk,
+            LexerOptions const & options,
+            size_t checkpoint_lines_step
+        ) noexcept
+        {
+            TraceSpan const lex_span{ TracePhase::Lex };
+
+            LexerData & lexer_data = chunk.lexer_data;
+            start_chunk_lexing(lexer_data, source_file, chunk, options);
+
+            size_t last_checkpoint_line = 0;
+
+            while (true)
+            {
+                size_t const line = lexer_data.line_index.size();
+                if (!is_between_lines_state_active(lexer_data) &&
+                    line - last_checkpoint_line >= checkpoint_lines_step)
+                {
+                    chunk.checkpoints.push_back({
+                        lexer_data.next_line_begin,
+                        lexer_data.data.tokens.size(),
+                        lexer_data.data.token_errors.size()
+                    });
+                    last_checkpoint_line = line;
+                    // errors before checkpoint are false if chunk is joined here,
+                    // so they must not use up limit of errors after it
+                    lexer_data.data.token_errors_begin = lexer_data.data.token_errors.size();
+                }
+
+                if (!next_line(lexer_data))
+                {
+                    break;
+                }
+                lex_line(lexer_data);
+            }
+        }
+
+        // appends speculative tokens after checkpoint to fixed ones,
+        // symbol table of fixed lexing stays in first occurrence order
+        void join_with_checkpoint(Chunk & chunk, LexerData & fixed_lexer_data, Checkpoint const & checkpoint) noexcept
+        {
+            CommonData & speculative = chunk.lexer_data.data;
+            CommonData & fixed = fixed_lexer_data.data;
+
+            std::vector<size_t> speculative_to_fixed(speculative.symbol_table.size(), std::numeric_limits<size_t>::max());
+
+            for (size_t i = checkpoint.tokens_count; i < speculative.tokens.size(); ++i)
+            {
+                Token token = speculative.tokens[i];
+                if (token.index_in_symbol_table != std::numeric_limits<size_t>::max())
+                {
+                    size_t & index = speculative_to_fixed[token.index_in_symbol_table];
+                    if (index == std::numeric_limits<size_t>::max())
+                    {
+                        index = fixed.symbol_table.insert(speculative.symbol_table[token.index_in_symbol_table]);
+                    }
+                    token.index_in_symbol_table = index;
+                }
+                fixed.tokens.push_back(token);
+            }
+
+            fixed.token_errors.insert(
+                fixed.token_errors.end(),
+                speculative.token_errors.begin() + checkpoint.token_errors_count,
+                speculative.token_errors.end()
+            );
+
+            // after checkpoint both lexings are same, so speculative end state is right
+            fixed_lexer_data.commented_code_data = std::move(chunk.lexer_data.commented_code_data);
+            fixed_lexer_data.string_constant_data = std::move(chunk.lexer_data.string_constant_data);
+            fixed_lexer_data.preprocessor_directives_data = std::move(chunk.lexer_data.preprocessor_directives_data);
+            // speculative lexing has read all lines of chunk
+            fixed_lexer_data.line_index = std::move(chunk.lexer_data.line_index);
+        }
+
+        // lexes chunk again from real start state until it meets speculative lexing
+        void fix_chunk(
+            std::shared_ptr<SourceFile> const & source_file,
+            Chunk & chunk,
+            LexerData const & previous_lexer_data,
+            LexerOptions const & options
+        ) noexcept
+        {
+            TraceSpan const lex_span{ TracePhase::Lex };
+
+            LexerData fixed_lexer_data{};
+            start_chunk_lexing(fixed_lexer_data, source_file, chunk, options);
+
+            fixed_lexer_data.commented_code_data = previous_lexer_data.commented_code_data;
+            fixed_lexer_data.string_constant_data = previous_lexer_data.string_constant_data;
+            fixed_lexer_data.preprocessor_directives_data = previous_lexer_data.preprocessor_directives_data;
+
+            size_t checkpoint_index = 0;
+
+            while (true)
+            {
+                if (!is_between_lines_state_active(fixed_lexer_data))
+                {
+                    while (checkpoint_index < chunk.checkpoints.size() &&
+                        chunk.checkpoints[checkpoint_index].offset < fixed_lexer_data.next_line_begin)
+                    {
+                        ++checkpoint_index;
+                    }
+                    if (checkpoint_index < chunk.checkpoints.size() &&
+                        chunk.checkpoints[checkpoint_index].offset == fixed_lexer_data.next_line_begin)
+                    {
+                        join_with_checkpoint(chunk, fixed_lexer_data, chunk.checkpoints[checkpoint_index]);
+                        break;
+                    }
+                }
+
+                if (!next_line(fixed_lexer_data))
+                {
+                    break;
+                }
+                lex_line(fixed_lexer_data);
+            }
+
+            chunk.lexer_data = std::move(fixed_lexer_data);
+        }
+
+        lexer_output_t merge_chunks(
+            std::shared_ptr<SourceFile> const & source_file,
+            std::vector<Chunk> & chunks,
+            size_t threads_count,
+            LexerOptions const & options
+        ) noexcept
+        {
+            TraceSpan const symbol_merge_span{ TracePhase::SymbolMerge };
+
+            // chunk symbol tables are in first occurrence order,
+            // so adding them one by one gives same order as sequential lexing
+            symbol_table_t symbol_table = std::move(chunks.front().lexer_data.data.symbol_table);
+            std::vector<std::vector<size_t>> chunk_to_global(chunks.size());
+
+            for (size_t i = 1; i < chunks.size(); ++i)
+            {
+                symbol_table_t const & chunk_symbol_table = chunks[i].lexer_data.data.symbol_table;
+                chunk_to_global[i].resize(chunk_symbol_table.size());
+                for (size_t j = 0; j < chunk_symbol_table.size(); ++j)
+                {
+                    chunk_to_global[i][j] = symbol_table.insert(chunk_symbol_table[j]);
+                }
+            }
+
+            parallel_for(chunks.size() - 1, threads_count, [&chunks, &chunk_to_global](size_t i)
+                {
+                    tokens_t & tokens = chunks[i + 1].lexer_data.data.tokens;
+                    for (size_t j = 0; j < tokens.size(); ++j)
+                    {
+                        if (tokens.has_symbol(j))
+                        {
+                            tokens.set_index_in_symbol_table(j, chunk_to_global[i + 1][tokens.index_in_symbol_table(j)]);
+                        }
+                    }
+                });
+
+            size_t tokens_count = 0;
+            size_t token_errors_count = 0;
+            size_t lines_count = 0;
+            for (Chunk const & chunk : chunks)
+            {
+                tokens_count += chunk.lexer_data.data.tokens.size();
+                token_errors_count += chunk.lexer_data.data.token_errors.size();
+                lines_count += chunk.lexer_data.line_index.size();
+            }
+
+            tokens_t tokens{};
+            token_errors_t token_errors{};
+            LineIndex line_index{};
+            tokens.reserve(tokens_count);
+            token_errors.reserve(token_errors_count);
+            line_index.reserve(lines_count);
+
+            for (Chunk & chunk : chunks)
+            {
+                CommonData & data = chunk.lexer_data.data;
+                tokens.append(data.tokens);
+                line_index.append(chunk.lexer_data.line_index);
+                token_errors.insert(
+                    token_errors.end(),
+                    std::make_move_iterator(data.token_errors.begin()),
+                    std::make_move_iterator(data.token_errors.end())
+                );
+            }
+
+            // every error that sequential lexing keeps is in chunks, so whole file is cut as in sequential lexing
+            cap_token_errors(token_errors, options.max_token_errors_count);
+
+            tokens.set_line_index(std::move(line_index));
+            tokens.set_source(source_file, source_file->text());
+            return { std::move(symbol_table), { std::move(tokens), std::move(token_errors) } };
+        }
+    }
+
+    lexer_output_t get_tokens_parallel(
+        std::string const & file_path,
+        size_t threads_count,
+        LexerOptions const & options
+    ) noexcept(!IS_DEBUG)
+    {
+        return get_tokens_parallel(file_path, threads_count, options, ParallelLexingTuning{});
+    }
+
+    lexer_output_t get_tokens_parallel(
+        std::string const & file_path,
+        size_t threads_count,
+        LexerOptions const & options,
+        ParallelLexingTuning const & tuning
+    ) noexcept(!IS_DEBUG)
+    {
+        if (threads_count == 0)
+        {
+            threads_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+
+        TraceSpan const file_span{ TracePhase::File, file_path };
+
+        std::shared_ptr<SourceFile> const source_file = std::make_shared<SourceFile>();
+
+        if (!source_file->open(file_path))
+        {
+            assert(false && "Cannot open file");
+            return {};
+        }
+
+        std::string_view const source = source_file->text();
+
+        size_t const chunks_count = std::min(threads_count, source.size() / std::max<size_t>(tuning.min_chunk_size, 1));
+        // small file is lexed on this thread inside same file span,
+        // get_tokens would open it again and record second file span
+        if (chunks_count <= 1)
+        {
+            LexerData lexer_data{};
+            lexer_data.data.options = options;
+            lexer_data.source_file = source_file;
+            set_source(lexer_data, source, source_file);
+
+            TraceSpan const lex_span{ TracePhase::Lex };
+            return lex_source(lexer_data);
+        }
+
+        std::vector<Chunk> chunks = split_to_chunks(source, chunks_count);
+
+        // speculative lexing may find false errors (chunk may start inside comment and so on),
+        // so chunk keeps max_token_errors_count + 1 errors after every checkpoint
+        // and whole file is cut once in merge_chunks
+        parallel_for(chunks.size(), threads_count, [&chunks, &source_file, &options, &tuning](size_t i)
+            {
+                lex_chunk_speculatively(source_file, chunks[i], options, tuning.checkpoint_lines_step);
+            });
+
+        for (size_t i = 1; i < chunks.size(); ++i)
+        {
+            if (is_between_lines_state_active(chunks[i - 1].lexer_data))
+            {
+                fix_chunk(source_file, chunks[i], chunks[i - 1].lexer_data, options);
+            }
+        }
+
+        finish(chunks.back().lexer_data);
+
+        return merge_chunks(source_file, chunks, threads_count, options);
+    }
+}
@@ -0,0 +1,214 @@
+#include "source_file.h"
+#include "trace.h"
+
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace lexer
+{
+    SourceFile::~SourceFile() noexcept
+    {
+        close();
+    }
+
+    SourceFile::SourceFile(SourceFile && other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    SourceFile & SourceFile::operator=(SourceFile && other) noexcept
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+
+        close();
+
+        mapped_data = std::exchange(other.mapped_data, nullptr);
+        size = std::exchange(other.size, 0);
+        buffer = std::move(other.buffer);
+        // small buffer may live inside std::string object itself
+        data = (mapped_data != nullptr ? other.data : buffer.data());
+        other.data = nullptr;
+
+        return *this;
+    }
+
+    bool SourceFile::open(std::string const & file_path, uint64_t max_size) noexcept
+    {
+        close();
+
+        {
+            TraceSpan const open_span{ TracePhase::Open };
+            if (try_map(file_path, max_size))
+            {
+                return true;
+            }
+        }
+
+        TraceSpan const read_span{ TracePhase::Read };
+        if (!read(file_path, max_size))
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void SourceFile::close() noexcept
+    {
+        if (mapped_data != nullptr)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(mapped_data);
+#else
+            munmap(mapped_data, size);
+#endif
+            mapped_data = nullptr;
+        }
+
+        buffer.clear();
+        buffer.shrink_to_fit();
+        data = nullptr;
+        size = 0;
+    }
+
+#ifdef _WIN32
+    bool SourceFile::try_map(std::string const & file_path, uint64_t max_size) noexcept
+    {
+        HANDLE const file = CreateFileA(
+            file_path.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr
+        );
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER file_size{};
+        // empty file can not be mapped, too big file is not read at all
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 ||
+            static_cast<uint64_t>(file_size.QuadPart) > max_size)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE const mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr)
+        {
+            return false;
+        }
+
+        mapped_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (mapped_data == nullptr)
+        {
+            return false;
+        }
+
+        data = static_cast<char const *>(mapped_data);
+        size = static_cast<size_t>(file_size.QuadPart);
+        return true;
+    }
+#else
+    bool SourceFile::try_map(std::string const & file_path, uint64_t max_size) noexcept
+    {
+        // pipe is not opened here: data that is read from it by opening is lost for read
+        struct stat path_stat{};
+        if (stat(file_path.c_str(), &path_stat) != 0 || !S_ISREG(path_stat.st_mode))
+        {
+            return false;
+        }
+
+        int const file = ::open(file_path.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            return false;
+        }
+
+        struct stat file_stat{};
+        // empty file can not be mapped, too big file is not read at all
+        if (fstat(file, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || file_stat.st_size == 0 ||
+            static_cast<uint64_t>(file_stat.st_size) > max_size)
+        {
+            ::close(file);
+            return false;
+        }
+
+        void * const mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        ::close(file);
+        if (mapping == MAP_FAILED)
+        {
+            return false;
+        }
+        madvise(mapping, static_cast<size_t>(file_stat.st_size), MADV_SEQUENTIAL);
+
+        mapped_data = mapping;
+        data = static_cast<char const *>(mapped_data);
+        size = static_cast<size_t>(file_stat.st_size);
+        return true;
+    }
+#endif
+
+    bool SourceFile::read(std::string const & file_path, uint64_t max_size) noexcept
+    {
+        std::ifstream file_input{ file_path, std::ios::binary };
+        if (!file_input)
+        {
+            return false;
+        }
+
+        file_input.seekg(0, std::ios::end);
+        std::streamoff const file_size = file_input.tellg();
+        file_input.seekg(0, std::ios::beg);
+
+        // tellg gives -1 for pipes, so only known size is checked before reading
+        if (file_size > 0)
+        {
+            if (static_cast<uint64_t>(file_size) > max_size)
+            {
+                return false;
+            }
+            buffer.resize(static_cast<size_t>(file_size));
+            file_input.read(buffer.data(), file_size);
+            buffer.resize(static_cast<size_t>(file_input.gcount()));
+        }
+        else
+        {
+            // size is unknown (pipe, ...)
+            file_input.clear();
+            buffer.assign(std::istreambuf_iterator<char>{ file_input }, std::istreambuf_iterator<char>{});
+            if (buffer.size() > max_size)
+            {
+                buffer.clear();
+                buffer.shrink_to_fit();
+                return false;
+            }
+        }
+
+        data = buffer.data();
+        size = buffer.size();
+        return true;
+    }
+}
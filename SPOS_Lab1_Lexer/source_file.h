@@ -0,0 +1,45 @@
+#pragma once
+
+
+#include "line_index.h"
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+
+namespace lexer
+{
+    // whole file as one contiguous read-only buffer:
+    // memory mapped when possible, otherwise read into own buffer
+    class SourceFile
+    {
+    public:
+        SourceFile() noexcept = default;
+        ~SourceFile() noexcept;
+
+        SourceFile(SourceFile const &) = delete;
+        SourceFile & operator=(SourceFile const &) = delete;
+
+        SourceFile(SourceFile && other) noexcept;
+        SourceFile & operator=(SourceFile && other) noexcept;
+
+        // false if file could not be read or it is bigger than max_size,
+        // files that are not sources (token streams) may be bigger than max_source_size
+        bool open(std::string const & file_path, uint64_t max_size = max_source_size) noexcept;
+        void close() noexcept;
+
+        std::string_view text() const noexcept { return { data, size }; }
+        bool is_mapped() const noexcept { return mapped_data != nullptr; }
+
+    private:
+        bool try_map(std::string const & file_path, uint64_t max_size) noexcept;
+        bool read(std::string const & file_path, uint64_t max_size) noexcept;
+
+        char const * data{ nullptr };
+        size_t size{ 0 };
+
+        void * mapped_data{ nullptr };
+        std::string buffer{};
+    };
+}
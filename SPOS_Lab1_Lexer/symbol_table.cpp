@@ -0,0 +1,181 @@
+#include "symbol_table.h"
+
+#include <functional>
+#include <algorithm>
+
+
+namespace lexer
+{
+    SymbolTable::SymbolTable(SymbolTable const & other) noexcept
+        : hashes{ other.hashes },
+        slots{ other.slots },
+        source_owner{ other.source_owner },
+        source{ other.source }
+    {
+        symbols.reserve(other.symbols.size());
+        for (std::string_view const symbol : other.symbols)
+        {
+            symbols.push_back(store(symbol));
+        }
+    }
+
+    SymbolTable & SymbolTable::operator=(SymbolTable const & other) noexcept
+    {
+        if (this != &other)
+        {
+            *this = SymbolTable{ other };
+        }
+        return *this;
+    }
+
+    void SymbolTable::retain_source(std::shared_ptr<void const> owner, std::string_view source) noexcept
+    {
+        source_owner = std::move(owner);
+        this->source = source;
+    }
+
+    std::pair<size_t, bool> SymbolTable::try_get(std::string_view symbol) const noexcept
+    {
+        if (slots.empty())
+        {
+            return { std::numeric_limits<size_t>::max(), false };
+        }
+
+        size_t const index = slots[find_slot(symbol, std::hash<std::string_view>{}(symbol))];
+        if (index == empty_slot)
+        {
+            return { std::numeric_limits<size_t>::max(), false };
+        }
+        return { index, true };
+    }
+
+    size_t SymbolTable::insert(std::string_view symbol) noexcept
+    {
+        // keep load factor under 1/2
+        if ((symbols.size() + 1) * 2 > slots.size())
+        {
+            rehash(slots.empty() ? 64 : slots.size() * 2);
+        }
+
+        size_t const hash = std::hash<std::string_view>{}(symbol);
+        size_t const slot = find_slot(symbol, hash);
+        if (slots[slot] != empty_slot)
+        {
+            return slots[slot];
+        }
+
+        slots[slot] = symbols.size();
+        symbols.push_back(store(symbol));
+        hashes.push_back(hash);
+        return slots[slot];
+    }
+
+    void SymbolTable::clear() noexcept
+    {
+        symbols.clear();
+        hashes.clear();
+        std::fill(slots.begin(), slots.end(), empty_slot);
+
+        arena_block_index = 0;
+        arena_block_used = 0;
+        long_symbols_used = 0;
+    }
+
+    void SymbolTable::reserve(size_t count) noexcept
+    {
+        symbols.reserve(count);
+        hashes.reserve(count);
+
+        size_t slots_count = (slots.empty() ? 64 : slots.size());
+        while (count * 2 > slots_count)
+        {
+            slots_count *= 2;
+        }
+        if (slots_count != slots.size())
+        {
+            rehash(slots_count);
+        }
+    }
+
+    size_t SymbolTable::find_slot(std::string_view symbol, size_t hash) const noexcept
+    {
+        size_t const mask = slots.size() - 1;
+        size_t slot = hash & mask;
+
+        while (slots[slot] != empty_slot &&
+            !(hashes[slots[slot]] == hash && symbols[slots[slot]] == symbol))
+        {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void SymbolTable::rehash(size_t slots_count) noexcept
+    {
+        slots.assign(slots_count, empty_slot);
+
+        size_t const mask = slots_count - 1;
+        for (size_t i = 0; i < symbols.size(); ++i)
+        {
+            size_t slot = hashes[i] & mask;
+            while (slots[slot] != empty_slot)
+            {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = i;
+        }
+    }
+
+    bool SymbolTable::is_in_source(std::string_view symbol) const noexcept
+    {
+        uintptr_t const source_begin = reinterpret_cast<uintptr_t>(source.data());
+        uintptr_t const symbol_begin = reinterpret_cast<uintptr_t>(symbol.data());
+
+        return symbol_begin >= source_begin &&
+            symbol_begin + symbol.size() <= source_begin + source.size();
+    }
+
+    std::string_view SymbolTable::store(std::string_view symbol) noexcept
+    {
+        if (symbol.empty() || is_in_source(symbol))
+        {
+            return symbol;
+        }
+
+        char * data = nullptr;
+        if (symbol.size() > arena_block_size / 4)
+        {
+            // block that is kept from before clear() is taken if it is big enough
+            if (long_symbols_used == long_symbols.size() || long_symbols[long_symbols_used].size < symbol.size())
+            {
+                long_symbols.insert(
+                    long_symbols.begin() + long_symbols_used,
+                    { std::unique_ptr<char[]>{ new char[symbol.size()] }, symbol.size() }
+                );
+            }
+            data = long_symbols[long_symbols_used].data.get();
+            ++long_symbols_used;
+        }
+        else
+        {
+            if (arena_blocks.empty())
+            {
+                arena_blocks.emplace_back(new char[arena_block_size]);
+            }
+            if (arena_block_used + symbol.size() > arena_block_size)
+            {
+                ++arena_block_index;
+                arena_block_used = 0;
+                if (arena_block_index == arena_blocks.size())
+                {
+                    arena_blocks.emplace_back(new char[arena_block_size]);
+                }
+            }
+            data = arena_blocks[arena_block_index].get() + arena_block_used;
+            arena_block_used += symbol.size();
+        }
+
+        std::copy(symbol.begin(), symbol.end(), data);
+        return { data, symbol.size() };
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <limits>
+#include <memory>
+#include <cstdint>
+
+
+namespace lexer
+{
+    // symbols keep dense indices 0..N in insertion order,
+    // lookup goes through open addressing hash index (linear probing),
+    // symbols are views into retained source or into own bump allocated arena
+    class SymbolTable
+    {
+    public:
+        using const_iterator = std::vector<std::string_view>::const_iterator;
+
+        SymbolTable() noexcept = default;
+        ~SymbolTable() noexcept = default;
+
+        // arena symbols are copied, retained source is shared
+        SymbolTable(SymbolTable const & other) noexcept;
+        SymbolTable & operator=(SymbolTable const & other) noexcept;
+
+        SymbolTable(SymbolTable && other) noexcept = default;
+        SymbolTable & operator=(SymbolTable && other) noexcept = default;
+
+        // symbols inside source are not copied, owner keeps source alive
+        // (it may be empty if source outlives table)
+        void retain_source(std::shared_ptr<void const> owner, std::string_view source) noexcept;
+
+        std::pair<size_t, bool> try_get(std::string_view symbol) const noexcept;
+
+        // returns index of existing symbol or adds new one
+        size_t insert(std::string_view symbol) noexcept;
+
+        void clear() noexcept;
+        void reserve(size_t count) noexcept;
+
+        size_t size() const noexcept { return symbols.size(); }
+        bool empty() const noexcept { return symbols.empty(); }
+
+        std::string_view operator[](size_t index) const noexcept { return symbols[index]; }
+
+        const_iterator begin() const noexcept { return symbols.begin(); }
+        const_iterator end() const noexcept { return symbols.end(); }
+
+    private:
+        static constexpr size_t empty_slot = std::numeric_limits<size_t>::max();
+        static constexpr size_t arena_block_size = 1 << 16;
+
+        size_t find_slot(std::string_view symbol, size_t hash) const noexcept;
+        void rehash(size_t slots_count) noexcept;
+
+        bool is_in_source(std::string_view symbol) const noexcept;
+        // returns view that lives as long as table
+        std::string_view store(std::string_view symbol) noexcept;
+
+        std::vector<std::string_view> symbols{};
+        std::vector<size_t> hashes{};
+
+        // index in symbols or empty_slot, size is always power of two
+        std::vector<size_t> slots{};
+
+        std::shared_ptr<void const> source_owner{};
+        std::string_view source{};
+
+        struct LongSymbolBlock
+        {
+            std::unique_ptr<char[]> data;
+            size_t size;
+        };
+
+        // block arena_block_index is filled now, long symbols get own blocks,
+        // clear() keeps all blocks, so table that is reused does not allocate them again
+        std::vector<std::unique_ptr<char[]>> arena_blocks{};
+        size_t arena_block_index{ 0 };
+        size_t arena_block_used{ 0 };
+        std::vector<LongSymbolBlock> long_symbols{};
+        size_t long_symbols_used{ 0 };
+    };
+}
@@ -0,0 +1,195 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+
+namespace lexer
+{
+    namespace
+    {
+        thread_local ThreadPool const * current_pool{ nullptr };
+        thread_local size_t current_worker{ 0 };
+
+        // tasks of batch come close to each other, so idle worker checks for them
+        // that many times before it sleeps
+        constexpr size_t idle_spins_count = 64;
+    }
+
+    ThreadPool::ThreadPool(size_t threads_count) noexcept
+    {
+        if (threads_count == 0)
+        {
+            threads_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+
+        queues.reserve(threads_count);
+        for (size_t i = 0; i < threads_count; ++i)
+        {
+            queues.push_back(std::make_unique<TaskQueue>());
+        }
+
+        threads.reserve(threads_count);
+        for (size_t i = 0; i < threads_count; ++i)
+        {
+            threads.emplace_back([this, i]() { work(i); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() noexcept
+    {
+        wait();
+
+        {
+            std::lock_guard<std::mutex> lock{ mutex };
+            is_stopping.store(true);
+        }
+        has_tasks.notify_all();
+
+        for (std::thread & thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    void ThreadPool::submit(std::function<void()> task) noexcept
+    {
+        // task created by worker goes to its own queue
+        size_t queue_index = current_worker_index();
+        if (queue_index >= queues.size())
+        {
+            queue_index = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        }
+
+        // pending before queued, so wait never sees 0 while task is in queue
+        pending_count.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> queue_lock{ queues[queue_index]->mutex };
+            queues[queue_index]->tasks.push_back(std::move(task));
+        }
+        queued_count.fetch_add(1);
+
+        // sleeping worker checks queued count under mutex after it is counted as sleeping,
+        // so either it sees this task or this thread sees it sleeping
+        if (sleeping_count.load() > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock{ mutex };
+            }
+            has_tasks.notify_one();
+        }
+    }
+
+    void ThreadPool::wait() noexcept
+    {
+        if (pending_count.load() == 0)
+        {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock{ mutex };
+        is_all_done.wait(lock, [this]() { return pending_count.load() == 0; });
+    }
+
+    size_t ThreadPool::current_worker_index() const noexcept
+    {
+        return (current_pool == this ? current_worker : threads_count());
+    }
+
+    bool ThreadPool::try_reserve() noexcept
+    {
+        size_t count = queued_count.load();
+        while (count > 0)
+        {
+            if (queued_count.compare_exchange_weak(count, count - 1))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ThreadPool::try_pop(size_t worker_index, std::function<void()> & task) noexcept
+    {
+        {
+            TaskQueue & own_queue = *queues[worker_index];
+            std::lock_guard<std::mutex> queue_lock{ own_queue.mutex };
+            if (!own_queue.tasks.empty())
+            {
+                task = std::move(own_queue.tasks.back());
+                own_queue.tasks.pop_back();
+                return true;
+            }
+        }
+
+        for (size_t i = 1; i < queues.size(); ++i)
+        {
+            TaskQueue & other_queue = *queues[(worker_index + i) % queues.size()];
+            std::lock_guard<std::mutex> queue_lock{ other_queue.mutex };
+            if (!other_queue.tasks.empty())
+            {
+                task = std::move(other_queue.tasks.front());
+                other_queue.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool ThreadPool::wait_for_tasks() noexcept
+    {
+        for (size_t i = 0; i < idle_spins_count; ++i)
+        {
+            if (queued_count.load() > 0)
+            {
+                return true;
+            }
+            if (is_stopping.load())
+            {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lock{ mutex };
+        sleeping_count.fetch_add(1);
+        has_tasks.wait(lock, [this]() { return is_stopping.load() || queued_count.load() > 0; });
+        sleeping_count.fetch_sub(1);
+        return (queued_count.load() > 0);
+    }
+
+    void ThreadPool::work(size_t worker_index) noexcept
+    {
+        current_pool = this;
+        current_worker = worker_index;
+
+        while (true)
+        {
+            if (!try_reserve())
+            {
+                if (!wait_for_tasks())
+                {
+                    return;
+                }
+                continue;
+            }
+
+            // reserved task is in some queue, but other worker may take it from queue
+            // that was not checked yet, then another task is there
+            std::function<void()> task{};
+            while (!try_pop(worker_index, task))
+            {
+                std::this_thread::yield();
+            }
+            task();
+
+            if (pending_count.fetch_sub(1) == 1)
+            {
+                {
+                    std::lock_guard<std::mutex> lock{ mutex };
+                }
+                is_all_done.notify_all();
+            }
+        }
+    }
+}
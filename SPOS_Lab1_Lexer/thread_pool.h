@@ -0,0 +1,67 @@
+#pragma once
+
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+
+namespace lexer
+{
+    // every worker has own task queue: it takes tasks from its back
+    // and steals from front of other queues when own queue is empty,
+    // idle worker spins for a while and then sleeps until task is submitted
+    class ThreadPool
+    {
+    public:
+        // threads_count = 0 means number of hardware threads
+        explicit ThreadPool(size_t threads_count = 0) noexcept;
+        ~ThreadPool() noexcept;
+
+        ThreadPool(ThreadPool const &) = delete;
+        ThreadPool & operator=(ThreadPool const &) = delete;
+
+        void submit(std::function<void()> task) noexcept;
+        // waits until all submitted tasks are done
+        void wait() noexcept;
+
+        size_t threads_count() const noexcept { return threads.size(); }
+
+        // index of worker that runs current task, threads_count() outside of pool
+        size_t current_worker_index() const noexcept;
+
+    private:
+        struct TaskQueue
+        {
+            std::mutex mutex{};
+            std::deque<std::function<void()>> tasks{};
+        };
+
+        void work(size_t worker_index) noexcept;
+        // takes one of queued tasks for this worker, task is popped after that
+        bool try_reserve() noexcept;
+        bool try_pop(size_t worker_index, std::function<void()> & task) noexcept;
+        // false if pool is stopping and there are no tasks
+        bool wait_for_tasks() noexcept;
+
+        std::vector<std::unique_ptr<TaskQueue>> queues{};
+        std::vector<std::thread> threads{};
+
+        // counters are changed without mutex, it is taken only to sleep and to wake sleeping threads
+        std::mutex mutex{};
+        std::condition_variable has_tasks{};
+        std::condition_variable is_all_done{};
+        // tasks in queues that are not reserved by workers
+        std::atomic<size_t> queued_count{ 0 };
+        // tasks in queues or running
+        std::atomic<size_t> pending_count{ 0 };
+        std::atomic<size_t> sleeping_count{ 0 };
+        std::atomic<size_t> next_queue{ 0 };
+        std::atomic<bool> is_stopping{ false };
+    };
+}
@@ -0,0 +1,372 @@
+#include "token_stream.h"
+
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <limits>
+
+
+namespace lexer
+{
+    namespace
+    {
+        constexpr uint64_t section_alignment = 8;
+
+        uint64_t align(uint64_t position) noexcept
+        {
+            return (position + section_alignment - 1) / section_alignment * section_alignment;
+        }
+
+        // values are collected into small buffer, so file is written by big blocks
+        class SectionWriter
+        {
+        public:
+            explicit SectionWriter(std::ofstream & os) noexcept
+                : os{ os }
+            {
+
+            }
+
+            template <typename T>
+            void write(T const & value) noexcept
+            {
+                write(std::string_view{ reinterpret_cast<char const *>(&value), sizeof(T) });
+            }
+
+            void write(std::string_view bytes) noexcept
+            {
+                position += bytes.size();
+                if (used + bytes.size() > buffer.size())
+                {
+                    flush();
+                    if (bytes.size() > buffer.size())
+                    {
+                        os.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+                        return;
+                    }
+                }
+                std::memcpy(buffer.data() + used, bytes.data(), bytes.size());
+                used += bytes.size();
+            }
+
+            void pad_to(uint64_t section_position) noexcept
+            {
+                while (position < section_position)
+                {
+                    write(char{ 0 });
+                }
+            }
+
+            void flush() noexcept
+            {
+                os.write(buffer.data(), static_cast<std::streamsize>(used));
+                used = 0;
+            }
+
+        private:
+            static constexpr size_t buffer_size = 1 << 16;
+
+            std::ofstream & os;
+            std::vector<char> buffer = std::vector<char>(buffer_size);
+            size_t used{ 0 };
+            uint64_t position{ 0 };
+        };
+    }
+
+    bool write_token_stream(std::string const & file_path, lexer_output_t const & lexer_output) noexcept
+    {
+        symbol_table_t const & symbol_table = lexer_output.first;
+        tokens_t const & tokens = lexer_output.second.first;
+        token_errors_t const & token_errors = lexer_output.second.second;
+        LineIndex const & line_index = tokens.line_index();
+
+        uint64_t strings_size = 0;
+        for (std::string_view const symbol : symbol_table)
+        {
+            strings_size += symbol.size();
+        }
+
+        // all sizes are known, so header is written first and file is written in one pass
+        TokenStreamHeader header{};
+        std::memcpy(header.magic, token_stream_magic, sizeof(header.magic));
+        header.version = token_stream_version;
+        header.byte_order_mark = token_stream_byte_order_mark;
+        header.tokens_count = tokens.size();
+        header.lines_count = line_index.size();
+        header.symbols_count = symbol_table.size();
+        header.errors_count = token_errors.size();
+        header.strings_size = strings_size;
+
+        header.types_position = align(sizeof(TokenStreamHeader));
+        header.offsets_position = align(header.types_position + header.tokens_count * sizeof(uint8_t));
+        header.symbol_ids_position = align(header.offsets_position + header.tokens_count * sizeof(uint32_t));
+        header.line_begins_position = align(header.symbol_ids_position + header.tokens_count * sizeof(uint32_t));
+        header.symbol_bounds_position = align(header.line_begins_position + header.lines_count * sizeof(uint32_t));
+        header.errors_position = align(header.symbol_bounds_position + (header.symbols_count + 1) * sizeof(uint32_t));
+        header.strings_position = align(header.errors_position + header.errors_count * sizeof(TokenStreamError));
+
+        std::ofstream os{ file_path, std::ios::binary | std::ios::trunc };
+        if (!os)
+        {
+            return false;
+        }
+
+        SectionWriter writer{ os };
+        writer.write(header);
+
+        writer.pad_to(header.types_position);
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            writer.write(static_cast<uint8_t>(tokens.type(i)));
+        }
+
+        writer.pad_to(header.offsets_position);
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            writer.write(static_cast<uint32_t>(tokens.offset(i)));
+        }
+
+        writer.pad_to(header.symbol_ids_position);
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            size_t const index = tokens.index_in_symbol_table(i);
+            writer.write(index == std::numeric_limits<size_t>::max() ?
+                std::numeric_limits<uint32_t>::max() :
+                static_cast<uint32_t>(index)
+            );
+        }
+
+        writer.pad_to(header.line_begins_position);
+        for (size_t i = 0; i < line_index.size(); ++i)
+        {
+            writer.write(static_cast<uint32_t>(line_index.line_begin(i)));
+        }
+
+        uint32_t string_position = 0;
+
+        writer.pad_to(header.symbol_bounds_position);
+        writer.write(string_position);
+        for (std::string_view const symbol : symbol_table)
+        {
+            string_position += static_cast<uint32_t>(symbol.size());
+            writer.write(string_position);
+        }
+
+        writer.pad_to(header.errors_position);
+        for (TokenError const & token_error : token_errors)
+        {
+            TokenStreamError error{};
+            error.offset = token_error.offset;
+            error.symbol_offset = token_error.symbol_offset;
+            error.length = token_error.length;
+            error.code = static_cast<uint32_t>(token_error.code);
+            writer.write(error);
+        }
+
+        writer.pad_to(header.strings_position);
+        for (std::string_view const symbol : symbol_table)
+        {
+            writer.write(symbol);
+        }
+
+        writer.flush();
+        return static_cast<bool>(os);
+    }
+
+    bool TokenStream::open(std::string const & file_path) noexcept
+    {
+        close();
+
+        // stream is several times bigger than its source, so it is not limited by max_source_size
+        if (!file.open(file_path, std::numeric_limits<size_t>::max()))
+        {
+            return false;
+        }
+        data = file.text();
+
+        auto const is_section_valid = [this](uint64_t position, uint64_t count, uint64_t element_size)
+            {
+                return position % section_alignment == 0 &&
+                    position <= data.size() &&
+                    count <= (data.size() - position) / element_size;
+            };
+
+        if (data.size() < sizeof(TokenStreamHeader))
+        {
+            close();
+            return false;
+        }
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        if (std::memcmp(header.magic, token_stream_magic, sizeof(token_stream_magic)) != 0 ||
+            header.version != token_stream_version ||
+            header.byte_order_mark != token_stream_byte_order_mark ||
+            !is_section_valid(header.types_position, header.tokens_count, sizeof(uint8_t)) ||
+            !is_section_valid(header.offsets_position, header.tokens_count, sizeof(uint32_t)) ||
+            !is_section_valid(header.symbol_ids_position, header.tokens_count, sizeof(uint32_t)) ||
+            !is_section_valid(header.line_begins_position, header.lines_count, sizeof(uint32_t)) ||
+            !is_section_valid(header.symbol_bounds_position, header.symbols_count + 1, sizeof(uint32_t)) ||
+            !is_section_valid(header.errors_position, header.errors_count, sizeof(TokenStreamError)) ||
+            !is_section_valid(header.strings_position, header.strings_size, sizeof(char)) ||
+            !are_values_valid())
+        {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    // damaged or foreign file may have right sizes, but wrong values that accessors would trust
+    bool TokenStream::are_values_valid() const noexcept
+    {
+        // max symbol id means token without symbol
+        if (header.symbols_count >= std::numeric_limits<uint32_t>::max())
+        {
+            return false;
+        }
+
+        size_t previous_offset = 0;
+        for (size_t i = 0; i < tokens_count(); ++i)
+        {
+            if (static_cast<uint8_t>(data[static_cast<size_t>(header.types_position) + i]) >=
+                static_cast<uint8_t>(TokenType::CountOf))
+            {
+                return false;
+            }
+
+            // tokens are sorted by offset
+            size_t const token_offset = offset(i);
+            if (token_offset < previous_offset)
+            {
+                return false;
+            }
+            previous_offset = token_offset;
+
+            uint32_t const symbol_index = read_uint32(header.symbol_ids_position, i);
+            if (symbol_index >= header.symbols_count && symbol_index != std::numeric_limits<uint32_t>::max())
+            {
+                return false;
+            }
+        }
+
+        for (size_t i = 1; i < lines_count(); ++i)
+        {
+            if (line_begin(i) < line_begin(i - 1))
+            {
+                return false;
+            }
+        }
+
+        if (read_uint32(header.symbol_bounds_position, 0) != 0)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < symbols_count(); ++i)
+        {
+            uint32_t const end = read_uint32(header.symbol_bounds_position, i + 1);
+            if (end < read_uint32(header.symbol_bounds_position, i) || end > header.strings_size)
+            {
+                return false;
+            }
+        }
+
+        for (size_t i = 0; i < errors_count(); ++i)
+        {
+            TokenStreamError error{};
+            std::memcpy(&error, data.data() + header.errors_position + i * sizeof(TokenStreamError), sizeof(error));
+            if (error.code >= static_cast<uint32_t>(TokenErrorCode::CountOf) ||
+                uint64_t{ error.symbol_offset } + error.length > max_source_size)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void TokenStream::close() noexcept
+    {
+        file.close();
+        data = {};
+        header = {};
+    }
+
+    TokenType TokenStream::type(size_t index) const noexcept
+    {
+        return static_cast<TokenType>(data[static_cast<size_t>(header.types_position) + index]);
+    }
+
+    size_t TokenStream::offset(size_t index) const noexcept
+    {
+        return read_uint32(header.offsets_position, index);
+    }
+
+    size_t TokenStream::index_in_symbol_table(size_t index) const noexcept
+    {
+        uint32_t const symbol_index = read_uint32(header.symbol_ids_position, index);
+        return (symbol_index == std::numeric_limits<uint32_t>::max() ? std::numeric_limits<size_t>::max() : symbol_index);
+    }
+
+    Token TokenStream::operator[](size_t index) const noexcept
+    {
+        return { offset(index), type(index), index_in_symbol_table(index) };
+    }
+
+    std::string_view TokenStream::symbol(size_t index) const noexcept
+    {
+        return read_string(
+            read_uint32(header.symbol_bounds_position, index),
+            read_uint32(header.symbol_bounds_position, index + 1)
+        );
+    }
+
+    TokenError TokenStream::error(size_t index) const noexcept
+    {
+        TokenStreamError error{};
+        std::memcpy(&error, data.data() + header.errors_position + index * sizeof(TokenStreamError), sizeof(error));
+
+        return { static_cast<TokenErrorCode>(error.code), error.offset, error.symbol_offset, error.length };
+    }
+
+    size_t TokenStream::line(size_t offset) const noexcept
+    {
+        // first line that begins after offset
+        size_t begin = 0;
+        size_t end = static_cast<size_t>(header.lines_count);
+        while (begin < end)
+        {
+            size_t const middle = begin + (end - begin) / 2;
+            if (line_begin(middle) <= offset)
+            {
+                begin = middle + 1;
+            }
+            else
+            {
+                end = middle;
+            }
+        }
+        return (begin == 0 ? 0 : begin - 1);
+    }
+
+    size_t TokenStream::column(size_t offset) const noexcept
+    {
+        if (header.lines_count == 0)
+        {
+            return offset;
+        }
+        return offset - line_begin(line(offset));
+    }
+
+    uint32_t TokenStream::read_uint32(uint64_t position, size_t index) const noexcept
+    {
+        uint32_t value{};
+        std::memcpy(&value, data.data() + position + index * sizeof(uint32_t), sizeof(value));
+        return value;
+    }
+
+    std::string_view TokenStream::read_string(uint32_t begin, uint32_t end) const noexcept
+    {
+        return data.substr(static_cast<size_t>(header.strings_position) + begin, end - begin);
+    }
+}
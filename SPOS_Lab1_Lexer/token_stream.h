@@ -0,0 +1,106 @@
+#pragma once
+
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+#include "lexer.h"
+#include "source_file.h"
+
+
+namespace lexer
+{
+    // binary token stream file, native byte order, all sections are aligned to 8 bytes:
+    //   header
+    //   token types         uint8_t[tokens_count]
+    //   token offsets       uint32_t[tokens_count]
+    //   token symbol ids    uint32_t[tokens_count], max for tokens without symbol
+    //   line begins         uint32_t[lines_count]
+    //   symbol bounds       uint32_t[symbols_count + 1], symbol i is strings[bounds[i], bounds[i + 1])
+    //   errors              TokenStreamError[errors_count]
+    //   strings             char[strings_size]
+    constexpr char token_stream_magic[4]{ 'L', 'X', 'T', 'S' };
+    constexpr uint32_t token_stream_version = 2;
+    constexpr uint32_t token_stream_byte_order_mark = 0x01020304;
+
+    struct TokenStreamHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t byte_order_mark;
+        uint32_t reserved;
+
+        uint64_t tokens_count;
+        uint64_t lines_count;
+        uint64_t symbols_count;
+        uint64_t errors_count;
+        uint64_t strings_size;
+
+        uint64_t types_position;
+        uint64_t offsets_position;
+        uint64_t symbol_ids_position;
+        uint64_t line_begins_position;
+        uint64_t symbol_bounds_position;
+        uint64_t errors_position;
+        uint64_t strings_position;
+    };
+
+    // same as TokenError, symbol is span of lexed source, it is not written
+    struct TokenStreamError
+    {
+        uint32_t offset;
+        uint32_t symbol_offset;
+        uint32_t length;
+        uint32_t code;
+    };
+
+    // writes output in one pass, false if file could not be written
+    bool write_token_stream(std::string const & file_path, lexer_output_t const & lexer_output) noexcept;
+
+    // token stream file mapped into memory: nothing is parsed or copied on load,
+    // all accessors read mapped data, views live as long as stream is open
+    class TokenStream
+    {
+    public:
+        // false if file could not be opened or it is not valid token stream of current version,
+        // values of all sections are checked, so accessors can trust them
+        bool open(std::string const & file_path) noexcept;
+        void close() noexcept;
+
+        // whole mapped file, symbols are views into it
+        std::string_view text() const noexcept { return data; }
+
+        size_t tokens_count() const noexcept { return static_cast<size_t>(header.tokens_count); }
+        TokenType type(size_t index) const noexcept;
+        size_t offset(size_t index) const noexcept;
+        size_t index_in_symbol_table(size_t index) const noexcept;
+        Token operator[](size_t index) const noexcept;
+
+        size_t symbols_count() const noexcept { return static_cast<size_t>(header.symbols_count); }
+        std::string_view symbol(size_t index) const noexcept;
+
+        size_t errors_count() const noexcept { return static_cast<size_t>(header.errors_count); }
+        // symbol of error is span of source that was lexed
+        TokenError error(size_t index) const noexcept;
+
+        size_t lines_count() const noexcept { return static_cast<size_t>(header.lines_count); }
+        size_t line_begin(size_t line) const noexcept { return read_uint32(header.line_begins_position, line); }
+
+        // same as in LineIndex
+        size_t line(size_t offset) const noexcept;
+        size_t column(size_t offset) const noexcept;
+
+    private:
+        bool are_values_valid() const noexcept;
+
+        uint32_t read_uint32(uint64_t position, size_t index) const noexcept;
+        std::string_view read_string(uint32_t begin, uint32_t end) const noexcept;
+
+        SourceFile file{};
+        std::string_view data{};
+        // copy of header, zero counts while stream is not open
+        TokenStreamHeader header{};
+    };
+}
@@ -0,0 +1,315 @@
+#include "trace.h"
+
+#include <atomic>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace lexer
+{
+    namespace
+    {
+        constexpr size_t events_block_size = 1024;
+        constexpr size_t names_block_size = 1 << 16;
+
+        struct TraceEvent
+        {
+            TracePhase phase{ TracePhase::File };
+            uint64_t begin_nanoseconds{ 0 };
+            uint64_t duration_nanoseconds{ 0 };
+            // view into names arena of thread
+            std::string_view name{};
+        };
+
+        struct TraceEventsBlock
+        {
+            std::array<TraceEvent, events_block_size> events{};
+            std::unique_ptr<TraceEventsBlock> next{};
+        };
+
+        // names longer than block get own block
+        struct TraceNamesBlock
+        {
+            explicit TraceNamesBlock(size_t size) noexcept
+                : data{ std::make_unique<char[]>(size) },
+                size{ size }
+            {
+
+            }
+
+            std::unique_ptr<char[]> data;
+            size_t size;
+            size_t used{ 0 };
+            std::unique_ptr<TraceNamesBlock> next{};
+        };
+
+        // only owner thread writes events, count is published after event is written,
+        // so events before count can be read by other thread without locks
+        class ThreadTraceBuffer
+        {
+        public:
+            explicit ThreadTraceBuffer(size_t thread_index) noexcept
+                : thread_index{ thread_index },
+                first{ std::make_unique<TraceEventsBlock>() },
+                last{ first.get() },
+                first_names{ std::make_unique<TraceNamesBlock>(names_block_size) },
+                last_names{ first_names.get() }
+            {
+
+            }
+
+            ~ThreadTraceBuffer() noexcept
+            {
+                clear();
+            }
+
+            ThreadTraceBuffer(ThreadTraceBuffer const &) = delete;
+            ThreadTraceBuffer & operator=(ThreadTraceBuffer const &) = delete;
+
+            void push(TraceEvent event) noexcept
+            {
+                size_t const count = events_count.load(std::memory_order_relaxed);
+                size_t const index_in_block = count % events_block_size;
+                if (count > 0 && index_in_block == 0)
+                {
+                    last->next = std::make_unique<TraceEventsBlock>();
+                    last = last->next.get();
+                }
+
+                last->events[index_in_block] = event;
+                events_count.store(count + 1, std::memory_order_release);
+            }
+
+            // name is copied once into arena, so span does not allocate,
+            // nested spans of one file have same name, so last name is reused
+            std::string_view intern(std::string_view name) noexcept
+            {
+                if (name.empty() || name == last_name)
+                {
+                    return (name.empty() ? std::string_view{} : last_name);
+                }
+
+                if (last_names->size - last_names->used < name.size())
+                {
+                    last_names->next = std::make_unique<TraceNamesBlock>(std::max(names_block_size, name.size()));
+                    last_names = last_names->next.get();
+                }
+
+                char * const data = last_names->data.get() + last_names->used;
+                std::memcpy(data, name.data(), name.size());
+                last_names->used += name.size();
+                last_name = { data, name.size() };
+                return last_name;
+            }
+
+            // blocks are released one by one, not by recursive destructors
+            void clear() noexcept
+            {
+                std::unique_ptr<TraceEventsBlock> block = std::move(first->next);
+                while (block)
+                {
+                    block = std::move(block->next);
+                }
+
+                first->events = {};
+                last = first.get();
+                events_count.store(0, std::memory_order_relaxed);
+
+                std::unique_ptr<TraceNamesBlock> names_block = std::move(first_names->next);
+                while (names_block)
+                {
+                    names_block = std::move(names_block->next);
+                }
+
+                first_names->used = 0;
+                last_names = first_names.get();
+                last_name = {};
+            }
+
+            template <typename Function>
+            void for_each(Function const & function) const noexcept
+            {
+                size_t const count = events_count.load(std::memory_order_acquire);
+                TraceEventsBlock const * block = first.get();
+                for (size_t i = 0; i < count; ++i)
+                {
+                    if (i > 0 && i % events_block_size == 0)
+                    {
+                        block = block->next.get();
+                    }
+                    function(block->events[i % events_block_size]);
+                }
+            }
+
+            size_t index() const noexcept { return thread_index; }
+
+        private:
+            size_t thread_index;
+
+            std::unique_ptr<TraceEventsBlock> first;
+            TraceEventsBlock * last;
+            std::atomic<size_t> events_count{ 0 };
+
+            std::unique_ptr<TraceNamesBlock> first_names;
+            TraceNamesBlock * last_names;
+            std::string_view last_name{};
+        };
+
+        struct TraceRegistry
+        {
+            std::mutex mutex{};
+            // buffers stay after their threads end, so their spans are written too
+            std::vector<std::unique_ptr<ThreadTraceBuffer>> buffers{};
+
+            std::atomic<bool> is_tracing{ false };
+            uint64_t begin_nanoseconds{ 0 };
+        };
+
+        // never destroyed: spans may end in threads that outlive static objects
+        TraceRegistry & get_registry() noexcept
+        {
+            static TraceRegistry * const registry = new TraceRegistry{};
+            return *registry;
+        }
+
+        thread_local ThreadTraceBuffer * thread_buffer{ nullptr };
+
+        // lock is taken once per thread
+        ThreadTraceBuffer & get_thread_buffer() noexcept
+        {
+            if (thread_buffer == nullptr)
+            {
+                TraceRegistry & registry = get_registry();
+                std::lock_guard<std::mutex> lock{ registry.mutex };
+                registry.buffers.push_back(std::make_unique<ThreadTraceBuffer>(registry.buffers.size()));
+                thread_buffer = registry.buffers.back().get();
+            }
+            return *thread_buffer;
+        }
+
+        uint64_t now_nanoseconds() noexcept
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()
+            ).count());
+        }
+
+        void output_json_string(std::ostream & os, std::string_view text) noexcept
+        {
+            constexpr char hex_digits[] = "0123456789abcdef";
+
+            os << '"';
+            for (char const c : text)
+            {
+                unsigned char const symbol = static_cast<unsigned char>(c);
+                if (symbol == '"' || symbol == '\\')
+                {
+                    os << '\\' << c;
+                }
+                else if (symbol < 0x20)
+                {
+                    os << "\\u00" << hex_digits[symbol >> 4] << hex_digits[symbol & 0xf];
+                }
+                else
+                {
+                    os << c;
+                }
+            }
+            os << '"';
+        }
+
+        // trace event timestamps are in microseconds
+        void output_microseconds(std::ostream & os, uint64_t nanoseconds) noexcept
+        {
+            uint64_t const fraction = nanoseconds % 1000;
+            os << nanoseconds / 1000 << '.' <<
+                static_cast<char>('0' + fraction / 100) <<
+                static_cast<char>('0' + fraction / 10 % 10) <<
+                static_cast<char>('0' + fraction % 10);
+        }
+    }
+
+    void start_tracing() noexcept
+    {
+        TraceRegistry & registry = get_registry();
+        std::lock_guard<std::mutex> lock{ registry.mutex };
+
+        for (std::unique_ptr<ThreadTraceBuffer> const & buffer : registry.buffers)
+        {
+            buffer->clear();
+        }
+        registry.begin_nanoseconds = now_nanoseconds();
+        registry.is_tracing.store(true, std::memory_order_release);
+    }
+
+    void stop_tracing() noexcept
+    {
+        get_registry().is_tracing.store(false, std::memory_order_release);
+    }
+
+    bool is_tracing() noexcept
+    {
+        return get_registry().is_tracing.load(std::memory_order_relaxed);
+    }
+
+    void write_chrome_trace(std::ostream & os) noexcept
+    {
+        TraceRegistry & registry = get_registry();
+        std::lock_guard<std::mutex> lock{ registry.mutex };
+
+        os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        bool is_first = true;
+        for (std::unique_ptr<ThreadTraceBuffer> const & buffer : registry.buffers)
+        {
+            os << (is_first ? "\n" : ",\n");
+            is_first = false;
+            os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->index() <<
+                ",\"args\":{\"name\":\"thread " << buffer->index() << "\"}}";
+
+            buffer->for_each([&os, &buffer, &registry](TraceEvent const & event)
+                {
+                    // spans that began before start_tracing are cut
+                    uint64_t const begin = std::max(event.begin_nanoseconds, registry.begin_nanoseconds);
+                    uint64_t const end = std::max(event.begin_nanoseconds + event.duration_nanoseconds, begin);
+
+                    os << ",\n{\"name\":";
+                    output_json_string(os, event.name.empty() ? Trace_phase_to_string[static_cast<uint8_t>(event.phase)] : event.name);
+                    os << ",\"cat\":\"" << Trace_phase_to_string[static_cast<uint8_t>(event.phase)] <<
+                        "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->index() << ",\"ts\":";
+                    output_microseconds(os, begin - registry.begin_nanoseconds);
+                    os << ",\"dur\":";
+                    output_microseconds(os, end - begin);
+                    os << '}';
+                });
+        }
+
+        os << "\n]}\n";
+    }
+
+    TraceSpan::TraceSpan(TracePhase phase, std::string_view name) noexcept
+        : phase{ phase },
+        is_active{ is_tracing() },
+        name{ name },
+        begin_nanoseconds{ is_active ? now_nanoseconds() : 0 }
+    {
+
+    }
+
+    TraceSpan::~TraceSpan() noexcept
+    {
+        if (!is_active)
+        {
+            return;
+        }
+
+        uint64_t const end_nanoseconds = now_nanoseconds();
+        ThreadTraceBuffer & buffer = get_thread_buffer();
+        buffer.push({ phase, begin_nanoseconds, end_nanoseconds - begin_nanoseconds, buffer.intern(name) });
+    }
+}
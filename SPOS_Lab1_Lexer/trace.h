@@ -0,0 +1,64 @@
+#pragma once
+
+
+#include <ostream>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace lexer
+{
+    enum class TracePhase : uint8_t
+    {
+        // whole get_tokens or get_tokens_parallel call, span is named by file path
+        File,
+        // opening and memory mapping of file, pages of mapped file are read later, while it is lexed
+        Open,
+        // reading of file that can not be mapped
+        Read,
+        Lex,
+        SymbolMerge,
+        Output,
+
+        CountOf
+    };
+
+    constexpr char const * Trace_phase_to_string[static_cast<uint8_t>(TracePhase::CountOf)] =
+    {
+        "file",
+        "open",
+        "read",
+        "lex",
+        "symbol_merge",
+        "output"
+    };
+
+    // tracing is off until start_tracing, then spans of every thread are recorded into own buffer
+    // of that thread without locks, start and stop must not be called while other threads are traced
+    void start_tracing() noexcept;
+    void stop_tracing() noexcept;
+    bool is_tracing() noexcept;
+
+    // Chrome trace event JSON (chrome://tracing, Perfetto) of spans that are recorded
+    // since last start_tracing, one track per thread
+    void write_chrome_trace(std::ostream & os) noexcept;
+
+    // records span from construction to destruction if tracing is on at construction
+    class TraceSpan
+    {
+    public:
+        // name must live until span ends, empty name means name of phase
+        explicit TraceSpan(TracePhase phase, std::string_view name = {}) noexcept;
+        ~TraceSpan() noexcept;
+
+        TraceSpan(TraceSpan const &) = delete;
+        TraceSpan & operator=(TraceSpan const &) = delete;
+
+    private:
+        TracePhase phase;
+        bool is_active;
+        std::string_view name;
+        uint64_t begin_nanoseconds;
+    };
+}
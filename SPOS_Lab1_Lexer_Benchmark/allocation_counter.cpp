@@ -0,0 +1,134 @@
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+namespace benchmark
+{
+    namespace
+    {
+        // size of block is kept before it, header keeps alignment of malloc
+        constexpr size_t header_size = alignof(std::max_align_t);
+
+        std::atomic<size_t> allocations_count{ 0 };
+        std::atomic<size_t> allocated_bytes{ 0 };
+        std::atomic<size_t> live_bytes{ 0 };
+        std::atomic<size_t> peak_live_bytes{ 0 };
+
+        void * allocate(size_t size)
+        {
+            char * const block = static_cast<char *>(std::malloc(header_size + size));
+            if (block == nullptr)
+            {
+                throw std::bad_alloc{};
+            }
+            std::memcpy(block, &size, sizeof(size));
+
+            allocations_count.fetch_add(1, std::memory_order_relaxed);
+            allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+            size_t const live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+            size_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+            while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+            {
+
+            }
+
+            return block + header_size;
+        }
+
+        void deallocate(void * pointer) noexcept
+        {
+            if (pointer == nullptr)
+            {
+                return;
+            }
+            char * const block = static_cast<char *>(pointer) - header_size;
+            size_t size{};
+            std::memcpy(&size, block, sizeof(size));
+            live_bytes.fetch_sub(size, std::memory_order_relaxed);
+            std::free(block);
+        }
+    }
+
+    AllocationStatistics get_allocation_statistics() noexcept
+    {
+        return {
+            allocations_count.load(std::memory_order_relaxed),
+            allocated_bytes.load(std::memory_order_relaxed),
+            peak_live_bytes.load(std::memory_order_relaxed)
+        };
+    }
+
+    void reset_allocation_statistics() noexcept
+    {
+        allocations_count = 0;
+        allocated_bytes = 0;
+        peak_live_bytes = live_bytes.load();
+    }
+
+    size_t get_peak_process_memory() noexcept
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        {
+            return 0;
+        }
+        return counters.PeakWorkingSetSize;
+#else
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+        {
+            return 0;
+        }
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss);
+#else
+        // kilobytes on linux
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+    }
+}
+
+void * operator new(size_t size)
+{
+    return benchmark::allocate(size);
+}
+
+void * operator new[](size_t size)
+{
+    return benchmark::allocate(size);
+}
+
+void operator delete(void * pointer) noexcept
+{
+    benchmark::deallocate(pointer);
+}
+
+void operator delete[](void * pointer) noexcept
+{
+    benchmark::deallocate(pointer);
+}
+
+void operator delete(void * pointer, size_t) noexcept
+{
+    benchmark::deallocate(pointer);
+}
+
+void operator delete[](void * pointer, size_t) noexcept
+{
+    benchmark::deallocate(pointer);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+
+#include <cstddef>
+
+
+namespace benchmark
+{
+    // global operator new and delete are replaced in this program to count heap usage
+    struct AllocationStatistics
+    {
+        size_t allocations_count;
+        size_t allocated_bytes;
+        // most bytes that were allocated at once since last reset
+        size_t peak_live_bytes;
+    };
+
+    AllocationStatistics get_allocation_statistics() noexcept;
+    // peak starts from bytes that are allocated now
+    void reset_allocation_statistics() noexcept;
+
+    // peak resident memory of whole process, 0 if it is not known
+    size_t get_peak_process_memory() noexcept;
+}
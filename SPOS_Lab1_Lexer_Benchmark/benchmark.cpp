@@ -0,0 +1,557 @@
+#include "lexer.h"
+#include "trace.h"
+#include "corpus_generator.h"
+#include "allocation_counter.h"
+#include "lexer_checks.h"
+#include "micro_benchmarks.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <filesystem>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// benchmark of lexer::get_tokens on generated corpora, results are written as json:
+//   SPOS_Lab1_Lexer_Benchmark [--sizes 64K,1M,16M] [--corpora identifiers,strings,...] [--repetitions 5]
+//                             [--seed 1] [--directory benchmark_corpora] [--output benchmark_results.json] [--label text]
+//                             [--trace trace.json] [--check-context-allocations 100] [--skip-categories comments,...]
+//                             [--check-parallel 100] [--check-concurrent 100] [--check-incremental 100]
+//                             [--micro symbols,keywords,char_scan,block_comments]
+namespace
+{
+    struct Options
+    {
+        std::vector<size_t> sizes{ 64 << 10, 1 << 20, 16 << 20 };
+        std::vector<benchmark::CorpusKind> corpora{};
+        size_t repetitions{ 5 };
+        uint64_t seed{ 1 };
+        std::string directory{ "benchmark_corpora" };
+        std::string output{ "benchmark_results.json" };
+        // commit or any other text that identifies measured build
+        std::string label{};
+        // chrome trace of measured runs is written if it is not empty
+        std::string trace{};
+        // if not 0, benchmark only checks that reused lexer context does not allocate
+        // on that many small files after first pass over them
+        size_t context_check_files_count{ 0 };
+        // if not 0, benchmark only checks that parallel lexing of that many fuzz sources
+        // gives same output as sequential one
+        size_t parallel_check_sources_count{ 0 };
+        // if not 0, benchmark only lexes that many fuzz sources from many threads at once,
+        // build with thread sanitizer to check for data races
+        size_t concurrent_check_sources_count{ 0 };
+        // if not 0, benchmark only checks that random edits of that many fuzz sources by incremental lexer
+        // give same output as lexing of whole edited code
+        size_t incremental_check_sources_count{ 0 };
+        // if not empty, benchmark only runs these micro benchmarks and writes them to std::cout
+        std::vector<benchmark::MicroBenchmarkKind> micro_benchmarks{};
+        // tokens of skipped categories are not created by measured lexing
+        lexer::LexerOptions lexer_options{};
+    };
+
+    struct CaseResult
+    {
+        benchmark::CorpusKind kind;
+        size_t size;
+        size_t tokens_count;
+        size_t errors_count;
+        double min_milliseconds;
+        double median_milliseconds;
+        size_t allocations_count;
+        size_t allocated_bytes;
+        size_t peak_heap_bytes;
+    };
+
+    std::vector<std::string_view> split(std::string_view text, char separator) noexcept
+    {
+        std::vector<std::string_view> parts{};
+        while (!text.empty())
+        {
+            size_t const end = std::min(text.find(separator), text.size());
+            parts.push_back(text.substr(0, end));
+            text.remove_prefix(std::min(end + 1, text.size()));
+        }
+        return parts;
+    }
+
+    // K, M and G suffixes are powers of 1024
+    std::pair<size_t, bool> try_parse_size(std::string_view text) noexcept
+    {
+        size_t multiplier = 1;
+        if (!text.empty())
+        {
+            switch (text.back())
+            {
+            case 'K': multiplier = size_t{ 1 } << 10; break;
+            case 'M': multiplier = size_t{ 1 } << 20; break;
+            case 'G': multiplier = size_t{ 1 } << 30; break;
+            default: break;
+            }
+        }
+        if (multiplier != 1)
+        {
+            text.remove_suffix(1);
+        }
+        size_t value{ 0 };
+        std::from_chars_result const result = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (text.empty() || result.ec != std::errc{} || result.ptr != text.data() + text.size())
+        {
+            return { 0, false };
+        }
+        return { value * multiplier, true };
+    }
+
+    std::pair<benchmark::CorpusKind, bool> try_parse_corpus_kind(std::string_view text) noexcept
+    {
+        for (uint8_t i = 0; i < static_cast<uint8_t>(benchmark::CorpusKind::CountOf); ++i)
+        {
+            if (text == benchmark::Corpus_kind_to_string[i])
+            {
+                return { static_cast<benchmark::CorpusKind>(i), true };
+            }
+        }
+        return { benchmark::CorpusKind::CountOf, false };
+    }
+
+    std::pair<benchmark::MicroBenchmarkKind, bool> try_parse_micro_benchmark_kind(std::string_view text) noexcept
+    {
+        for (uint8_t i = 0; i < static_cast<uint8_t>(benchmark::MicroBenchmarkKind::CountOf); ++i)
+        {
+            if (text == benchmark::Micro_benchmark_kind_to_string[i])
+            {
+                return { static_cast<benchmark::MicroBenchmarkKind>(i), true };
+            }
+        }
+        return { benchmark::MicroBenchmarkKind::CountOf, false };
+    }
+
+    std::pair<lexer::TokenCategory, bool> try_parse_token_category(std::string_view text) noexcept
+    {
+        for (uint8_t i = 0; i < static_cast<uint8_t>(lexer::TokenCategory::CountOf); ++i)
+        {
+            if (text == lexer::Token_category_to_string[i])
+            {
+                return { static_cast<lexer::TokenCategory>(i), true };
+            }
+        }
+        return { lexer::TokenCategory::CountOf, false };
+    }
+
+    std::pair<Options, bool> try_parse_options(int argc, char ** argv) noexcept
+    {
+        Options options{};
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            std::string_view const name = argv[i];
+            std::string_view const value = argv[i + 1];
+
+            if (name == "--sizes")
+            {
+                options.sizes.clear();
+                for (std::string_view const part : split(value, ','))
+                {
+                    std::pair<size_t, bool> const size = try_parse_size(part);
+                    if (!size.second)
+                    {
+                        return { options, false };
+                    }
+                    options.sizes.push_back(size.first);
+                }
+            }
+            else if (name == "--corpora")
+            {
+                for (std::string_view const part : split(value, ','))
+                {
+                    std::pair<benchmark::CorpusKind, bool> const kind = try_parse_corpus_kind(part);
+                    if (!kind.second)
+                    {
+                        return { options, false };
+                    }
+                    options.corpora.push_back(kind.first);
+                }
+            }
+            else if (name == "--repetitions")
+            {
+                std::pair<size_t, bool> const repetitions = try_parse_size(value);
+                if (!repetitions.second || repetitions.first == 0)
+                {
+                    return { options, false };
+                }
+                options.repetitions = repetitions.first;
+            }
+            else if (name == "--seed")
+            {
+                std::pair<size_t, bool> const seed = try_parse_size(value);
+                if (!seed.second)
+                {
+                    return { options, false };
+                }
+                options.seed = seed.first;
+            }
+            else if (name == "--directory")
+            {
+                options.directory = value;
+            }
+            else if (name == "--output")
+            {
+                options.output = value;
+            }
+            else if (name == "--label")
+            {
+                options.label = value;
+            }
+            else if (name == "--trace")
+            {
+                options.trace = value;
+            }
+            else if (name == "--check-context-allocations")
+            {
+                std::pair<size_t, bool> const files_count = try_parse_size(value);
+                if (!files_count.second)
+                {
+                    return { options, false };
+                }
+                options.context_check_files_count = files_count.first;
+            }
+            else if (name == "--check-parallel")
+            {
+                std::pair<size_t, bool> const sources_count = try_parse_size(value);
+                if (!sources_count.second)
+                {
+                    return { options, false };
+                }
+                options.parallel_check_sources_count = sources_count.first;
+            }
+            else if (name == "--check-concurrent")
+            {
+                std::pair<size_t, bool> const sources_count = try_parse_size(value);
+                if (!sources_count.second)
+                {
+                    return { options, false };
+                }
+                options.concurrent_check_sources_count = sources_count.first;
+            }
+            else if (name == "--check-incremental")
+            {
+                std::pair<size_t, bool> const sources_count = try_parse_size(value);
+                if (!sources_count.second)
+                {
+                    return { options, false };
+                }
+                options.incremental_check_sources_count = sources_count.first;
+            }
+            else if (name == "--micro")
+            {
+                for (std::string_view const part : split(value, ','))
+                {
+                    std::pair<benchmark::MicroBenchmarkKind, bool> const kind = try_parse_micro_benchmark_kind(part);
+                    if (!kind.second)
+                    {
+                        return { options, false };
+                    }
+                    options.micro_benchmarks.push_back(kind.first);
+                }
+            }
+            else if (name == "--skip-categories")
+            {
+                for (std::string_view const part : split(value, ','))
+                {
+                    std::pair<lexer::TokenCategory, bool> const category = try_parse_token_category(part);
+                    if (!category.second)
+                    {
+                        return { options, false };
+                    }
+                    options.lexer_options.token_categories &= ~lexer::get_token_category_bit(category.first);
+                }
+            }
+            else
+            {
+                return { options, false };
+            }
+        }
+        if (argc % 2 == 0)
+        {
+            return { options, false };
+        }
+
+        if (options.corpora.empty())
+        {
+            for (uint8_t i = 0; i < static_cast<uint8_t>(benchmark::CorpusKind::CountOf); ++i)
+            {
+                options.corpora.push_back(static_cast<benchmark::CorpusKind>(i));
+            }
+        }
+        return { options, true };
+    }
+
+    // corpus is generated once, name keeps everything that changes its text
+    std::string get_corpus(Options const & options, benchmark::CorpusKind kind, size_t size, uint64_t seed) noexcept
+    {
+        std::filesystem::path const file_path = std::filesystem::path{ options.directory } / (
+            std::string{ benchmark::Corpus_kind_to_string[static_cast<uint8_t>(kind)] } +
+            '_' + std::to_string(size) +
+            "_seed" + std::to_string(seed) +
+            "_v" + std::to_string(benchmark::corpus_generator_version) + ".txt"
+        );
+
+        std::error_code error{};
+        if (!std::filesystem::exists(file_path, error))
+        {
+            std::filesystem::create_directories(options.directory, error);
+
+            // written under temporary name, so interrupted generation is not reused
+            std::filesystem::path temporary_path = file_path;
+            temporary_path += ".tmp";
+            {
+                std::ofstream os{ temporary_path, std::ios::binary | std::ios::trunc };
+                benchmark::generate_corpus(os, kind, size, seed);
+            }
+            std::filesystem::rename(temporary_path, file_path, error);
+        }
+        return file_path.string();
+    }
+
+    CaseResult run_case(Options const & options, benchmark::CorpusKind kind, size_t size) noexcept
+    {
+        std::string const file_path = get_corpus(options, kind, size, options.seed);
+
+        std::error_code error{};
+        size_t const file_size = static_cast<size_t>(std::filesystem::file_size(file_path, error));
+
+        CaseResult result{};
+        result.kind = kind;
+        result.size = file_size;
+
+        // first run warms file cache and is not measured
+        {
+            lexer::lexer_output_t const lexer_output = lexer::get_tokens(file_path, options.lexer_options);
+            result.tokens_count = lexer_output.second.first.size();
+            result.errors_count = lexer_output.second.second.size();
+        }
+
+        std::vector<double> milliseconds{};
+        for (size_t i = 0; i < options.repetitions; ++i)
+        {
+            benchmark::reset_allocation_statistics();
+
+            auto const begin = std::chrono::steady_clock::now();
+            {
+                lexer::lexer_output_t const lexer_output = lexer::get_tokens(file_path, options.lexer_options);
+            }
+            auto const end = std::chrono::steady_clock::now();
+
+            milliseconds.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+
+            // same in every run
+            benchmark::AllocationStatistics const statistics = benchmark::get_allocation_statistics();
+            result.allocations_count = statistics.allocations_count;
+            result.allocated_bytes = statistics.allocated_bytes;
+            result.peak_heap_bytes = statistics.peak_live_bytes;
+        }
+
+        std::sort(milliseconds.begin(), milliseconds.end());
+        result.min_milliseconds = milliseconds.front();
+        result.median_milliseconds = milliseconds[milliseconds.size() / 2];
+        return result;
+    }
+
+    double megabytes_per_second(CaseResult const & result) noexcept
+    {
+        return static_cast<double>(result.size) / (1 << 20) / (result.median_milliseconds / 1000.0);
+    }
+
+    double tokens_per_second(CaseResult const & result) noexcept
+    {
+        return static_cast<double>(result.tokens_count) / (result.median_milliseconds / 1000.0);
+    }
+
+    void output_json_string(std::ostream & os, std::string_view text) noexcept
+    {
+        os << '"';
+        for (char const c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                os << '\\';
+            }
+            os << c;
+        }
+        os << '"';
+    }
+
+    void output_results(std::ostream & os, Options const & options, std::vector<CaseResult> const & results) noexcept
+    {
+        os << std::fixed << std::setprecision(3);
+        os << "{\n";
+        os << "  \"label\": ";
+        output_json_string(os, options.label);
+        os << ",\n";
+        os << "  \"seed\": " << options.seed << ",\n";
+        os << "  \"repetitions\": " << options.repetitions << ",\n";
+        os << "  \"corpus_generator_version\": " << benchmark::corpus_generator_version << ",\n";
+        os << "  \"peak_process_memory_bytes\": " << benchmark::get_peak_process_memory() << ",\n";
+        os << "  \"cases\": [\n";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            CaseResult const & result = results[i];
+            os << "    {";
+            os << "\"corpus\": \"" << benchmark::Corpus_kind_to_string[static_cast<uint8_t>(result.kind)] << "\", ";
+            os << "\"size_bytes\": " << result.size << ", ";
+            os << "\"tokens\": " << result.tokens_count << ", ";
+            os << "\"errors\": " << result.errors_count << ", ";
+            os << "\"min_ms\": " << result.min_milliseconds << ", ";
+            os << "\"median_ms\": " << result.median_milliseconds << ", ";
+            os << "\"mb_per_s\": " << megabytes_per_second(result) << ", ";
+            os << "\"tokens_per_s\": " << tokens_per_second(result) << ", ";
+            os << "\"allocations\": " << result.allocations_count << ", ";
+            os << "\"allocated_bytes\": " << result.allocated_bytes << ", ";
+            os << "\"peak_heap_bytes\": " << result.peak_heap_bytes;
+            os << (i + 1 < results.size() ? "},\n" : "}\n");
+        }
+        os << "  ]\n";
+        os << "}\n";
+    }
+
+    // many small files workload: after first pass buffers of context are big enough for every file,
+    // so second pass must not allocate, errors are not formatted, so files with errors are checked too
+    bool check_context_allocations(Options const & options) noexcept
+    {
+        std::vector<std::string> file_paths{};
+        file_paths.reserve(options.context_check_files_count);
+        for (size_t i = 0; i < options.context_check_files_count; ++i)
+        {
+            benchmark::CorpusKind const kind = options.corpora[i % options.corpora.size()];
+            size_t const size = size_t{ 1 } << (10 + i % 7);
+            file_paths.push_back(get_corpus(options, kind, size, options.seed + i));
+        }
+
+        lexer::LexerContext context{ options.lexer_options };
+        for (std::string const & file_path : file_paths)
+        {
+            context.lex_file(file_path);
+        }
+
+        size_t failed_files_count = 0;
+        size_t files_with_errors_count = 0;
+        for (std::string const & file_path : file_paths)
+        {
+            benchmark::reset_allocation_statistics();
+            context.lex_file(file_path);
+            size_t const allocations_count = benchmark::get_allocation_statistics().allocations_count;
+
+            if (!context.token_errors().empty())
+            {
+                ++files_with_errors_count;
+            }
+            if (allocations_count != 0)
+            {
+                ++failed_files_count;
+                std::cerr << file_path << ": " << allocations_count << " allocations\n";
+            }
+        }
+
+        std::cout << "Lexer context: " << file_paths.size() << " files checked (" <<
+            files_with_errors_count << " with errors), " << failed_files_count << " of them allocated\n";
+        return failed_files_count == 0;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    std::pair<Options, bool> const options = try_parse_options(argc, argv);
+    if (!options.second)
+    {
+        std::cerr << "Usage: " << argv[0] <<
+            " [--sizes 64K,1M,16M] [--corpora identifiers,operators,...] [--repetitions 5]"
+            " [--seed 1] [--directory benchmark_corpora] [--output benchmark_results.json] [--label text]"
+            " [--trace trace.json] [--check-context-allocations 100] [--skip-categories comments,...]"
+            " [--check-parallel 100] [--check-concurrent 100] [--check-incremental 100] [--micro symbols,keywords,char_scan,block_comments]\n";
+        return 1;
+    }
+
+    if (options.first.context_check_files_count != 0)
+    {
+        return (check_context_allocations(options.first) ? 0 : 1);
+    }
+    if (options.first.parallel_check_sources_count != 0)
+    {
+        return (benchmark::check_parallel_lexing(
+            options.first.directory,
+            options.first.parallel_check_sources_count,
+            options.first.seed
+        ) ? 0 : 1);
+    }
+    if (options.first.concurrent_check_sources_count != 0)
+    {
+        return (benchmark::check_concurrent_lexing(
+            options.first.directory,
+            options.first.concurrent_check_sources_count,
+            options.first.seed
+        ) ? 0 : 1);
+    }
+    if (options.first.incremental_check_sources_count != 0)
+    {
+        return (benchmark::check_incremental_lexing(
+            options.first.incremental_check_sources_count,
+            options.first.seed
+        ) ? 0 : 1);
+    }
+    if (!options.first.micro_benchmarks.empty())
+    {
+        for (benchmark::MicroBenchmarkKind const kind : options.first.micro_benchmarks)
+        {
+            benchmark::run_micro_benchmark(std::cout, kind, options.first.repetitions, options.first.seed);
+        }
+        return 0;
+    }
+
+    if (!options.first.trace.empty())
+    {
+        lexer::start_tracing();
+    }
+
+    std::vector<CaseResult> results{};
+    for (benchmark::CorpusKind const kind : options.first.corpora)
+    {
+        for (size_t const size : options.first.sizes)
+        {
+            CaseResult const result = run_case(options.first, kind, size);
+            results.push_back(result);
+
+            std::cout << std::left << std::setw(15) << benchmark::Corpus_kind_to_string[static_cast<uint8_t>(kind)] <<
+                std::right << std::setw(12) << result.size << " B " <<
+                std::fixed << std::setprecision(1) <<
+                std::setw(9) << result.median_milliseconds << " ms " <<
+                std::setw(8) << megabytes_per_second(result) << " MB/s " <<
+                std::setw(12) << std::setprecision(0) << tokens_per_second(result) << " tokens/s " <<
+                std::setw(9) << result.allocations_count << " allocations\n";
+        }
+    }
+
+    if (!options.first.trace.empty())
+    {
+        lexer::stop_tracing();
+
+        std::ofstream trace_os{ options.first.trace };
+        lexer::write_chrome_trace(trace_os);
+        if (!trace_os)
+        {
+            std::cerr << "Cannot write " << options.first.trace << '\n';
+            return 1;
+        }
+    }
+
+    std::ofstream os{ options.first.output };
+    output_results(os, options.first, results);
+    if (!os)
+    {
+        std::cerr << "Cannot write " << options.first.output << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,726 @@
+#include "corpus_generator.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+
+
+namespace benchmark
+{
+    namespace
+    {
+        constexpr size_t block_size = 1 << 20;
+
+        constexpr char const * keywords[] =
+        {
+            "int", "char", "bool", "long", "unsigned", "double", "auto", "void", "const", "static",
+            "constexpr", "return", "if", "else", "for", "while", "true", "false", "using", "noexcept"
+        };
+
+        constexpr char const * type_keywords[] = { "int", "char", "bool", "long", "unsigned", "double", "auto", "void" };
+
+        constexpr char const * binary_operators[] =
+        {
+            "=", "+", "-", "*", "/", "%", "+=", "-=", "*=", "/=", "%=", "&&", "||", "==", "<", ">", "<=", ">=", "!=",
+            "&", "|", "^", "<<", ">>", "&=", "|=", "^=", "<<=", ">>="
+        };
+
+        constexpr char const * unary_operators[] = { "!", "~", "++", "--", "-", "*", "&" };
+
+        constexpr char const * syllables[] =
+        {
+            "get", "set", "data", "size", "count", "index", "value", "node", "tree", "list", "map", "key", "name", "type",
+            "buffer", "file", "line", "token", "symbol", "table", "parse", "read", "write", "begin", "end", "next", "prev"
+        };
+
+        constexpr char const * words[] =
+        {
+            "the", "lexer", "returns", "token", "for", "every", "symbol", "in", "source", "line", "and", "keeps", "index",
+            "of", "it", "is", "not", "copied", "when", "buffer", "grows", "so", "view", "stays", "valid", "until", "end"
+        };
+
+        constexpr char const * include_paths[] =
+        {
+            "vector", "string", "memory", "algorithm", "cstdint", "iostream", "lexer.h", "utility/hash.h", "io/file_reader.h"
+        };
+
+        // splitmix64: standard distributions are not same on all platforms, this one is
+        class Random
+        {
+        public:
+            explicit Random(uint64_t seed) noexcept
+                : state{ seed }
+            {
+
+            }
+
+            uint64_t next() noexcept
+            {
+                uint64_t value = (state += 0x9e3779b97f4a7c15);
+                value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+                value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+                return value ^ (value >> 31);
+            }
+
+            size_t below(size_t bound) noexcept
+            {
+                return static_cast<size_t>(next() % bound);
+            }
+
+            size_t between(size_t min, size_t max) noexcept
+            {
+                return min + below(max - min + 1);
+            }
+
+            bool chance(size_t percent) noexcept
+            {
+                return below(100) < percent;
+            }
+
+            // small indices are much more frequent, like words in real text
+            size_t skewed_below(size_t bound) noexcept
+            {
+                return below(below(bound) + 1);
+            }
+
+            template <typename T, size_t Size>
+            T const & pick(T const (&values)[Size]) noexcept
+            {
+                return values[below(Size)];
+            }
+
+        private:
+            uint64_t state;
+        };
+
+        class CorpusGenerator
+        {
+        public:
+            explicit CorpusGenerator(uint64_t seed) noexcept
+                : random{ seed }
+            {
+                identifiers.reserve(identifiers_count);
+                for (size_t i = 0; i < identifiers_count; ++i)
+                {
+                    std::string identifier{ random.pick(syllables) };
+                    size_t const parts_count = random.between(0, 2);
+                    for (size_t j = 0; j < parts_count; ++j)
+                    {
+                        identifier += (random.chance(50) ? "_" : "");
+                        identifier += random.pick(syllables);
+                    }
+                    if (random.chance(20))
+                    {
+                        identifier += std::to_string(random.below(100));
+                    }
+                    identifiers.push_back(std::move(identifier));
+                }
+            }
+
+            void generate(std::ostream & os, CorpusKind kind, size_t size) noexcept
+            {
+                size_t written = 0;
+                while (written < size)
+                {
+                    text.clear();
+                    while (text.size() < block_size && written + text.size() < size)
+                    {
+                        add_unit(kind);
+                    }
+                    os.write(text.data(), static_cast<std::streamsize>(text.size()));
+                    written += text.size();
+                }
+            }
+
+        private:
+            static constexpr size_t identifiers_count = 4096;
+
+            void add_unit(CorpusKind kind) noexcept
+            {
+                switch (kind)
+                {
+                case CorpusKind::Identifiers: add_identifiers_line(); break;
+                case CorpusKind::Operators: add_operators_line(); break;
+                case CorpusKind::Comments: add_comment(); break;
+                case CorpusKind::Strings: add_strings_line(); break;
+                case CorpusKind::Numbers: add_numbers_line(); break;
+                case CorpusKind::Directives: add_directive(); break;
+                case CorpusKind::SourceFile: add_function(); break;
+                case CorpusKind::HeaderFile: add_declarations(); break;
+                case CorpusKind::MinifiedCode: add_minified_line(); break;
+                case CorpusKind::CountOf: break;
+                }
+            }
+
+            void add_identifier() noexcept
+            {
+                text += identifiers[random.skewed_below(identifiers.size())];
+            }
+
+            void add_number() noexcept
+            {
+                switch (random.below(6))
+                {
+                case 0: text += std::to_string(random.below(10)); break;
+                case 1: text += std::to_string(random.below(100000)); break;
+                case 2: text += std::to_string(random.below(1000)) + '.' + std::to_string(random.below(100000)); break;
+                case 3: text += "0x" + hex(random.next() & 0xffffffff); break;
+                case 4: text += "0b" + binary(random.below(256)); break;
+                case 5: text += std::to_string(random.between(10, 999)) + '\'' + std::to_string(random.between(100, 999)); break;
+                }
+            }
+
+            void add_string() noexcept
+            {
+                text += '"';
+                size_t const words_count = random.between(1, 8);
+                for (size_t i = 0; i < words_count; ++i)
+                {
+                    text += (i == 0 ? "" : " ");
+                    text += random.pick(words);
+                    if (random.chance(10))
+                    {
+                        text += (random.chance(50) ? "\\n" : "\\\"");
+                    }
+                }
+                text += '"';
+            }
+
+            void add_character() noexcept
+            {
+                text += '\'';
+                if (random.chance(20))
+                {
+                    text += (random.chance(50) ? "\\n" : "\\0");
+                }
+                else
+                {
+                    text += static_cast<char>('a' + random.below(26));
+                }
+                text += '\'';
+            }
+
+            void add_words(size_t min, size_t max) noexcept
+            {
+                size_t const words_count = random.between(min, max);
+                for (size_t i = 0; i < words_count; ++i)
+                {
+                    text += ' ';
+                    text += random.pick(words);
+                }
+            }
+
+            void add_expression(size_t operators_count) noexcept
+            {
+                add_operand();
+                for (size_t i = 0; i < operators_count; ++i)
+                {
+                    text += ' ';
+                    text += random.pick(binary_operators);
+                    text += ' ';
+                    add_operand();
+                }
+            }
+
+            // unary operators are not allowed without spaces around: "/" and "*" would start comment
+            void add_operand(bool is_unary_allowed = true) noexcept
+            {
+                if (is_unary_allowed && random.chance(10))
+                {
+                    text += random.pick(unary_operators);
+                }
+                switch (random.below(8))
+                {
+                case 0: add_number(); break;
+                case 1: add_identifier(); text += "->"; add_identifier(); break;
+                case 2: add_identifier(); text += "::"; add_identifier(); break;
+                case 3: add_identifier(); text += '['; add_identifier(); text += ']'; break;
+                case 4: add_call(); break;
+                default: add_identifier(); break;
+                }
+            }
+
+            void add_call() noexcept
+            {
+                add_identifier();
+                text += '(';
+                size_t const arguments_count = random.below(4);
+                for (size_t i = 0; i < arguments_count; ++i)
+                {
+                    text += (i == 0 ? "" : ", ");
+                    add_identifier();
+                }
+                text += ')';
+            }
+
+            void add_indent(size_t depth) noexcept
+            {
+                text.append(depth * 4, ' ');
+            }
+
+            void add_statement(size_t depth) noexcept
+            {
+                add_indent(depth);
+                switch (random.below(10))
+                {
+                case 0:
+                    text += random.pick(type_keywords);
+                    text += ' ';
+                    add_identifier();
+                    text += " = ";
+                    add_expression(random.below(3));
+                    break;
+                case 1:
+                    text += "return ";
+                    add_expression(random.below(3));
+                    break;
+                case 2:
+                    add_call();
+                    break;
+                case 3:
+                    text += "std::string const ";
+                    add_identifier();
+                    text += " = ";
+                    add_string();
+                    break;
+                default:
+                    add_identifier();
+                    text += ' ';
+                    text += random.pick(binary_operators);
+                    text += ' ';
+                    add_expression(random.below(4));
+                    break;
+                }
+                text += ";";
+                if (random.chance(10))
+                {
+                    text += " //";
+                    add_words(2, 6);
+                }
+                text += '\n';
+            }
+
+            void add_block_comment(size_t depth) noexcept
+            {
+                add_indent(depth);
+                text += "/*";
+                size_t const lines_count = random.between(1, 6);
+                for (size_t i = 0; i < lines_count; ++i)
+                {
+                    add_words(3, 10);
+                    text += '\n';
+                    add_indent(depth);
+                    text += " *";
+                }
+                text += "/\n";
+            }
+
+            void add_identifiers_line() noexcept
+            {
+                add_indent(random.below(3));
+                size_t const words_count = random.between(4, 10);
+                for (size_t i = 0; i < words_count; ++i)
+                {
+                    if (i > 0)
+                    {
+                        text += (random.chance(20) ? ", " : (random.chance(20) ? "." : " "));
+                    }
+                    if (random.chance(15))
+                    {
+                        text += random.pick(keywords);
+                    }
+                    else
+                    {
+                        add_identifier();
+                    }
+                }
+                text += ";\n";
+            }
+
+            void add_operators_line() noexcept
+            {
+                add_indent(1);
+                add_identifier();
+                text += ' ';
+                text += random.pick(binary_operators);
+                text += ' ';
+                text += '(';
+                add_expression(random.between(4, 12));
+                text += ") ? ";
+                add_identifier();
+                text += " : ";
+                add_identifier();
+                text += ";\n";
+            }
+
+            void add_comment() noexcept
+            {
+                if (random.chance(40))
+                {
+                    add_block_comment(random.below(2));
+                }
+                else
+                {
+                    add_indent(random.below(2));
+                    text += "//";
+                    add_words(3, 12);
+                    text += '\n';
+                }
+            }
+
+            void add_strings_line() noexcept
+            {
+                add_indent(1);
+                add_identifier();
+                text += '(';
+                size_t const arguments_count = random.between(1, 4);
+                for (size_t i = 0; i < arguments_count; ++i)
+                {
+                    text += (i == 0 ? "" : ", ");
+                    if (random.chance(25))
+                    {
+                        add_character();
+                    }
+                    else
+                    {
+                        add_string();
+                    }
+                }
+                text += ");\n";
+            }
+
+            void add_numbers_line() noexcept
+            {
+                add_indent(1);
+                text += "int const ";
+                add_identifier();
+                text += "[] = { ";
+                size_t const numbers_count = random.between(4, 16);
+                for (size_t i = 0; i < numbers_count; ++i)
+                {
+                    text += (i == 0 ? "" : ", ");
+                    add_number();
+                }
+                text += " };\n";
+            }
+
+            void add_directive() noexcept
+            {
+                switch (random.below(8))
+                {
+                case 0:
+                case 1:
+                {
+                    bool const is_system = random.chance(50);
+                    text += "#include ";
+                    text += (is_system ? '<' : '"');
+                    text += random.pick(include_paths);
+                    text += (is_system ? '>' : '"');
+                    break;
+                }
+                case 2:
+                    text += "#define ";
+                    add_identifier();
+                    text += ' ';
+                    add_expression(random.below(3));
+                    break;
+                case 3:
+                    text += "#define ";
+                    add_identifier();
+                    text += "(a, b) \\\n    ((a) + (b))";
+                    break;
+                case 4:
+                    text += "#ifdef ";
+                    add_identifier();
+                    break;
+                case 5:
+                    text += "#if ";
+                    add_expression(random.below(3));
+                    break;
+                case 6:
+                    text += (random.chance(50) ? "#endif" : "#else");
+                    break;
+                case 7:
+                    if (random.chance(50))
+                    {
+                        text += "#pragma once";
+                    }
+                    else
+                    {
+                        text += "#undef ";
+                        add_identifier();
+                    }
+                    break;
+                }
+                text += '\n';
+            }
+
+            void add_function() noexcept
+            {
+                if (random.chance(30))
+                {
+                    add_block_comment(0);
+                }
+                text += random.pick(type_keywords);
+                text += ' ';
+                add_call();
+                text += " noexcept\n{\n";
+
+                size_t const statements_count = random.between(2, 12);
+                for (size_t i = 0; i < statements_count; ++i)
+                {
+                    if (random.chance(15))
+                    {
+                        add_indent(1);
+                        text += "if (";
+                        add_expression(random.between(1, 3));
+                        text += ")\n    {\n";
+                        add_statement(2);
+                        text += "    }\n";
+                    }
+                    else
+                    {
+                        add_statement(1);
+                    }
+                }
+                text += "}\n\n";
+            }
+
+            void add_declarations() noexcept
+            {
+                if (random.chance(20))
+                {
+                    add_directive();
+                }
+
+                text += "//";
+                add_words(3, 10);
+                text += "\nstruct ";
+                add_identifier();
+                text += "\n{\n";
+                size_t const fields_count = random.between(1, 8);
+                for (size_t i = 0; i < fields_count; ++i)
+                {
+                    add_indent(1);
+                    text += random.pick(type_keywords);
+                    text += ' ';
+                    if (random.chance(30))
+                    {
+                        add_call();
+                        text += " const noexcept";
+                    }
+                    else
+                    {
+                        add_identifier();
+                        text += "{ ";
+                        add_number();
+                        text += " }";
+                    }
+                    text += ";\n";
+                }
+                text += "};\n\n";
+            }
+
+            void add_minified_line() noexcept
+            {
+                size_t const statements_count = random.between(50, 200);
+                for (size_t i = 0; i < statements_count; ++i)
+                {
+                    add_identifier();
+                    text += '=';
+                    add_operand(false);
+                    text += random.pick(binary_operators);
+                    add_operand(false);
+                    text += ';';
+                }
+                text += '\n';
+            }
+
+            static std::string hex(uint64_t value) noexcept
+            {
+                constexpr char hex_digits[] = "0123456789ABCDEF";
+                std::string digits{};
+                do
+                {
+                    digits.insert(digits.begin(), hex_digits[value & 0xf]);
+                    value >>= 4;
+                } while (value != 0);
+                return digits;
+            }
+
+            static std::string binary(uint64_t value) noexcept
+            {
+                std::string digits{};
+                do
+                {
+                    digits.insert(digits.begin(), static_cast<char>('0' + (value & 1)));
+                    value >>= 1;
+                } while (value != 0);
+                return digits;
+            }
+
+            Random random;
+            std::vector<std::string> identifiers{};
+            std::string text{};
+        };
+    }
+
+    void generate_corpus(std::ostream & os, CorpusKind kind, size_t size, uint64_t seed) noexcept
+    {
+        CorpusGenerator generator{ seed };
+        generator.generate(os, kind, size);
+    }
+
+    std::string generate_fuzz_source(size_t size, uint64_t seed) noexcept
+    {
+        constexpr char const * pieces[] =
+        {
+            "\n", "\n", "\n", "\r\n", " ", " ", "    ", "\t", "\\", "\\\n",
+            "//", "/*", "*/", "*", "/", "\"", "'", "'a'", "'\\''", "\"\\\"",
+            "#include <a.h>", "#define X", "#if 1", "#ifdef A", "#else", "#elif", "#endif", "#endifx", "#error", "#",
+            "0", "12", "0x1F", "0b101", "1.5", "1'000", "1..2", "1''0", "9x",
+            "int", "return", "while", "name", "_id2", "a",
+            "+", "+=", "<<=", "->", "::", "...", "?", ";", ",", "(", ")", "{", "}", "$", "@", "\x01", "\xff"
+        };
+
+        Random random{ seed };
+        std::string source{};
+        while (source.size() < size)
+        {
+            source += pieces[random.below(std::size(pieces))];
+        }
+        return source;
+    }
+
+    std::string generate_distinct_symbols_source(size_t size, size_t distinct_symbols_count, uint64_t seed) noexcept
+    {
+        // every identifier is used once before random ones, so all of them are in table,
+        // prefix keeps them apart from keywords
+        auto const append_identifier = [](std::string & source, size_t index)
+            {
+                source += "v_";
+                do
+                {
+                    source += static_cast<char>('a' + index % 26);
+                    index /= 26;
+                } while (index != 0);
+            };
+
+        Random random{ seed };
+        std::string source{};
+        source.reserve(size + 64);
+        for (size_t i = 0; source.size() < size || i < distinct_symbols_count; ++i)
+        {
+            size_t const index = (i < distinct_symbols_count ? i : random.below(distinct_symbols_count));
+            append_identifier(source, index);
+            source += " = ";
+            append_identifier(source, random.below(distinct_symbols_count));
+            source += " + 1;\n";
+        }
+        return source;
+    }
+
+    std::vector<std::string> generate_words(size_t count, size_t keywords_percent, uint64_t seed) noexcept
+    {
+        Random random{ seed };
+        std::vector<std::string> generated_words{};
+        generated_words.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (random.chance(keywords_percent))
+            {
+                generated_words.emplace_back(random.pick(keywords));
+                continue;
+            }
+
+            std::string identifier{ random.pick(syllables) };
+            if (random.chance(50))
+            {
+                identifier += '_';
+                identifier += random.pick(syllables);
+            }
+            generated_words.push_back(std::move(identifier));
+        }
+        return generated_words;
+    }
+
+    std::string generate_indented_source(size_t size, uint64_t seed) noexcept
+    {
+        Random random{ seed };
+        std::string source{};
+        source.reserve(size + 256);
+        size_t depth = 0;
+        while (source.size() < size)
+        {
+            // nesting walks up and down between 4 and 16 levels
+            depth = std::min<size_t>(std::max<size_t>(depth + random.between(0, 2), 5) - 1, 16);
+            source.append(depth * 4, ' ');
+            source += random.pick(syllables);
+            source += (random.chance(30) ? " {\n" : ";\n");
+            if (random.chance(20))
+            {
+                source += '\n';
+            }
+        }
+        return source;
+    }
+
+    std::string generate_long_identifiers_source(size_t size, uint64_t seed) noexcept
+    {
+        Random random{ seed };
+        auto const append_identifier = [&random](std::string & source)
+            {
+                size_t const length = random.between(30, 120);
+                size_t const begin = source.size();
+                while (source.size() - begin < length)
+                {
+                    source += random.pick(syllables);
+                    source += '_';
+                }
+                source.resize(begin + length);
+            };
+
+        std::string source{};
+        source.reserve(size + 512);
+        while (source.size() < size)
+        {
+            append_identifier(source);
+            source += " = ";
+            append_identifier(source);
+            source += '.';
+            append_identifier(source);
+            source += "();\n";
+        }
+        return source;
+    }
+
+    std::string generate_block_comments_source(size_t size, size_t comment_lines_count, uint64_t seed) noexcept
+    {
+        Random random{ seed };
+        std::string source{};
+        source.reserve(size + comment_lines_count * 96);
+        while (source.size() < size)
+        {
+            source += "/*\n";
+            for (size_t i = 0; i < comment_lines_count; ++i)
+            {
+                source += " *";
+                size_t const words_count = random.between(4, 12);
+                for (size_t j = 0; j < words_count; ++j)
+                {
+                    source += ' ';
+                    source += random.pick(words);
+                }
+                source += '\n';
+            }
+            source += " */\n";
+
+            source += "int ";
+            source += random.pick(syllables);
+            source += "()\n{\n    return 0;\n}\n";
+        }
+        return source;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace benchmark
+{
+    enum class CorpusKind : uint8_t
+    {
+        Identifiers,
+        Operators,
+        Comments,
+        Strings,
+        Numbers,
+        Directives,
+
+        // * real world shaped mixes
+        SourceFile,
+        HeaderFile,
+        MinifiedCode,
+
+        CountOf
+    };
+
+    constexpr char const * Corpus_kind_to_string[static_cast<uint8_t>(CorpusKind::CountOf)] =
+    {
+        "identifiers",
+        "operators",
+        "comments",
+        "strings",
+        "numbers",
+        "directives",
+
+        "source_file",
+        "header_file",
+        "minified_code"
+    };
+
+    // bump when generated text changes, so stale corpora on disk are not reused
+    constexpr uint32_t corpus_generator_version = 1;
+
+    // same kind, size and seed give same bytes on every platform,
+    // corpus is written by big blocks, consists of whole lines and is at least size bytes long
+    void generate_corpus(std::ostream & os, CorpusKind kind, size_t size, uint64_t seed) noexcept;
+
+    // random mix of pieces that begin and end comments, strings, directives, numbers and so on,
+    // it is not like real code, checks use it to compare lexing paths on every state change
+    std::string generate_fuzz_source(size_t size, uint64_t seed) noexcept;
+
+    // statements over exactly distinct_symbols_count identifiers that are used in random order,
+    // so symbol table grows to that size while source size stays same
+    std::string generate_distinct_symbols_source(size_t size, size_t distinct_symbols_count, uint64_t seed) noexcept;
+
+    // separate words like ones that lexer looks up as keywords,
+    // keywords_percent of them are keywords, others are identifiers
+    std::vector<std::string> generate_words(size_t count, size_t keywords_percent, uint64_t seed) noexcept;
+
+    // deeply nested blocks: most of bytes are indentation spaces
+    std::string generate_indented_source(size_t size, uint64_t seed) noexcept;
+    // statements over identifiers of 30 to 120 characters
+    std::string generate_long_identifiers_source(size_t size, uint64_t seed) noexcept;
+
+    // short functions between /* */ comments of comment_lines_count lines, like license headers
+    // and commented out code
+    std::string generate_block_comments_source(size_t size, size_t comment_lines_count, uint64_t seed) noexcept;
+}
@@ -0,0 +1,411 @@
+#include "lexer_checks.h"
+#include "corpus_generator.h"
+#include "lexer.h"
+#include "lexer_internal.h"
+#include "lex_cache.h"
+#include "trace.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <iterator>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+
+
+namespace benchmark
+{
+    namespace
+    {
+        constexpr size_t max_reported_mismatches_count = 5;
+
+        constexpr size_t incremental_edits_count = 50;
+        constexpr size_t max_edit_size = 40;
+
+        constexpr size_t check_error_caps[] = { 0, 1, 2, 3, 7, lexer::LexerOptions{}.max_token_errors_count };
+        constexpr size_t check_filters_count = 4;
+
+        // variant is index of error cap and token categories filter
+        constexpr size_t check_options_count = std::size(check_error_caps) * check_filters_count;
+
+        lexer::LexerOptions get_check_options(size_t variant) noexcept
+        {
+            lexer::LexerOptions options{};
+            options.max_token_errors_count = check_error_caps[variant % std::size(check_error_caps)];
+
+            switch (variant / std::size(check_error_caps))
+            {
+            case 1:
+                options.token_categories &= ~lexer::get_token_category_bit(lexer::TokenCategory::Comments);
+                break;
+            case 2:
+                options.token_categories &= ~(
+                    lexer::get_token_category_bit(lexer::TokenCategory::Literals) |
+                    lexer::get_token_category_bit(lexer::TokenCategory::PreprocessorDirectives)
+                );
+                break;
+            case 3:
+                options.interned_token_categories &= ~lexer::get_token_category_bit(lexer::TokenCategory::Identifiers);
+                break;
+            default:
+                break;
+            }
+            return options;
+        }
+
+        // text and json lines together cover tokens, symbols, errors and lines
+        std::string format_output(lexer::lexer_output_t const & lexer_output) noexcept
+        {
+            std::ostringstream os{};
+            lexer::OutputOptions options{};
+            lexer::output_lexer_data(os, lexer_output, options);
+            options.format = lexer::OutputFormat::JsonLines;
+            lexer::output_lexer_data(os, lexer_output, options);
+            return os.str();
+        }
+
+        // first line that differs
+        void report_mismatch(std::string_view name, std::string_view expected, std::string_view actual) noexcept
+        {
+            size_t line = 0;
+            size_t line_begin = 0;
+            size_t i = 0;
+            while (i < expected.size() && i < actual.size() && expected[i] == actual[i])
+            {
+                if (expected[i] == '\n')
+                {
+                    ++line;
+                    line_begin = i + 1;
+                }
+                ++i;
+            }
+
+            auto const get_line = [line_begin](std::string_view text)
+            {
+                text.remove_prefix(std::min(line_begin, text.size()));
+                return text.substr(0, text.find('\n'));
+            };
+
+            std::cerr << name << ": output differs at line " << line << "\n" <<
+                "  expected: " << get_line(expected) << "\n" <<
+                "  actual:   " << get_line(actual) << "\n";
+        }
+
+        // incremental lexer keeps symbols of removed tokens, so symbols are compared by text, not by index
+        std::string format_lexed_code(
+            std::string_view code,
+            lexer::symbol_table_t const & symbol_table,
+            lexer::tokens_t const & tokens,
+            lexer::token_errors_t const & token_errors
+        ) noexcept
+        {
+            std::ostringstream os{};
+            for (size_t i = 0; i < tokens.size(); ++i)
+            {
+                os << "token " << lexer::Token_to_string[static_cast<uint8_t>(tokens.type(i))] << ' ' << tokens.offset(i);
+                if (tokens.has_symbol(i))
+                {
+                    os << " symbol " << symbol_table[tokens.index_in_symbol_table(i)];
+                }
+                os << '\n';
+            }
+            for (lexer::TokenError const & token_error : token_errors)
+            {
+                os << "error " << token_error.message() << ' ' << token_error.offset << ' ' << token_error.symbol(code) << '\n';
+            }
+            lexer::LineIndex const & line_index = tokens.line_index();
+            for (size_t i = 0; i < line_index.size(); ++i)
+            {
+                os << "line " << line_index.line_begin(i) << '\n';
+            }
+            return os.str();
+        }
+
+        bool write_source(std::string const & file_path, std::string const & source) noexcept
+        {
+            std::ofstream os{ file_path, std::ios::binary | std::ios::trunc };
+            os << source;
+            return static_cast<bool>(os);
+        }
+
+        // fuzz sources are written once, so all threads read same files
+        std::pair<std::vector<std::string>, bool> write_fuzz_sources(
+            std::string const & directory,
+            std::string const & name,
+            size_t sources_count,
+            uint64_t seed
+        ) noexcept
+        {
+            std::error_code error{};
+            std::filesystem::create_directories(directory, error);
+
+            std::vector<std::string> file_paths{};
+            for (size_t i = 0; i < sources_count; ++i)
+            {
+                uint64_t const source_seed = seed + i;
+                std::string const file_path = (
+                    std::filesystem::path{ directory } / (name + '_' + std::to_string(source_seed) + ".txt")
+                ).string();
+                if (!write_source(file_path, generate_fuzz_source(256 + (source_seed * 97) % 4096, source_seed)))
+                {
+                    std::cerr << file_path << ": could not be written\n";
+                    return { file_paths, false };
+                }
+                file_paths.push_back(file_path);
+            }
+            return { file_paths, true };
+        }
+
+        void remove_files(std::vector<std::string> const & file_paths) noexcept
+        {
+            std::error_code error{};
+            for (std::string const & file_path : file_paths)
+            {
+                std::filesystem::remove(file_path, error);
+            }
+        }
+    }
+
+    bool check_parallel_lexing(std::string const & directory, size_t sources_count, uint64_t seed) noexcept
+    {
+        std::error_code error{};
+        std::filesystem::create_directories(directory, error);
+        std::string const file_path = (std::filesystem::path{ directory } / "check_parallel_source.txt").string();
+
+        size_t mismatches_count = 0;
+        for (size_t i = 0; i < sources_count; ++i)
+        {
+            uint64_t const source_seed = seed + i;
+            std::string const source = generate_fuzz_source(256 + (source_seed * 97) % 4096, source_seed);
+            if (!write_source(file_path, source))
+            {
+                std::cerr << file_path << ": could not be written\n";
+                return false;
+            }
+
+            // tiny chunks and checkpoints make every chunk start in other state
+            lexer::ParallelLexingTuning tuning{};
+            tuning.min_chunk_size = 16 + source_seed % 64;
+            tuning.checkpoint_lines_step = 1 + source_seed % 3;
+            size_t const threads_count = 2 + source_seed % 7;
+
+            for (size_t variant = 0; variant < check_options_count; ++variant)
+            {
+                lexer::LexerOptions const options = get_check_options(variant);
+
+                std::string const expected = format_output(lexer::get_tokens(file_path, options));
+                std::string const actual = format_output(lexer::get_tokens_parallel(file_path, threads_count, options, tuning));
+                if (expected == actual)
+                {
+                    continue;
+                }
+
+                if (mismatches_count < max_reported_mismatches_count)
+                {
+                    report_mismatch(
+                        "parallel, seed " + std::to_string(source_seed) + ", options " + std::to_string(variant),
+                        expected,
+                        actual
+                    );
+                }
+                ++mismatches_count;
+            }
+        }
+
+        std::filesystem::remove(file_path, error);
+
+        std::cout << "Parallel lexing: " << sources_count << " sources checked with " << check_options_count <<
+            " options each, " << mismatches_count << " mismatches\n";
+        return mismatches_count == 0;
+    }
+
+    bool check_concurrent_lexing(std::string const & directory, size_t sources_count, uint64_t seed) noexcept
+    {
+        std::pair<std::vector<std::string>, bool> const file_paths = write_fuzz_sources(
+            directory,
+            "check_concurrent_source",
+            sources_count,
+            seed
+        );
+        if (!file_paths.second)
+        {
+            remove_files(file_paths.first);
+            return false;
+        }
+
+        std::vector<std::string> expected{};
+        expected.reserve(file_paths.first.size());
+        for (std::string const & file_path : file_paths.first)
+        {
+            expected.push_back(format_output(lexer::get_tokens(file_path)));
+        }
+
+        std::string const cache_directory = (std::filesystem::path{ directory } / "check_concurrent_cache").string();
+        std::error_code error{};
+        std::filesystem::remove_all(cache_directory, error);
+        lexer::LexCache cache{ cache_directory, uint64_t{ 1 } << 30 };
+
+        lexer::ParallelLexingTuning tuning{};
+        tuning.min_chunk_size = 64;
+        tuning.checkpoint_lines_step = 2;
+
+        std::atomic<size_t> mismatches_count{ 0 };
+        auto const compare = [&mismatches_count](std::string_view name, std::string const & expected, std::string const & actual)
+            {
+                if (expected != actual && mismatches_count++ < max_reported_mismatches_count)
+                {
+                    report_mismatch(name, expected, actual);
+                }
+            };
+
+        // every thread walks sources in own order, so same file is lexed by several paths at once
+        size_t const threads_count = std::max<size_t>(std::thread::hardware_concurrency(), 4);
+        lexer::start_tracing();
+        std::vector<std::thread> threads{};
+        for (size_t thread_index = 0; thread_index < threads_count; ++thread_index)
+        {
+            threads.emplace_back([&, thread_index]()
+                {
+                    lexer::LexerContext context{};
+                    size_t const count = file_paths.first.size();
+                    for (size_t step = 0; step < count; ++step)
+                    {
+                        size_t const i = (step * (2 * thread_index + 1) + thread_index) % count;
+                        std::string const & file_path = file_paths.first[i];
+
+                        switch ((step + thread_index) % 4)
+                        {
+                        case 0:
+                            compare("concurrent get_tokens", expected[i], format_output(lexer::get_tokens(file_path)));
+                            break;
+                        case 1:
+                            compare(
+                                "concurrent get_tokens_parallel",
+                                expected[i],
+                                format_output(lexer::get_tokens_parallel(file_path, 3, lexer::LexerOptions{}, tuning))
+                            );
+                            break;
+                        case 2:
+                            compare("concurrent lex cache", expected[i], format_output(cache.get_tokens(file_path)));
+                            break;
+                        default:
+                            context.lex_file(file_path);
+                            // context keeps its source, so copied output is formatted while it is alive
+                            compare("concurrent lexer context", expected[i], format_output(lexer::lexer_output_t{
+                                context.symbol_table(),
+                                { context.tokens(), context.token_errors() }
+                            }));
+                            break;
+                        }
+                    }
+
+                    lexer::BatchLexerOutput const batch = lexer::get_tokens_batch(file_paths.first, thread_index % 2 == 0, 3);
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        compare("concurrent get_tokens_batch", expected[i], format_output(batch.files[i]));
+                    }
+                });
+        }
+        for (std::thread & thread : threads)
+        {
+            thread.join();
+        }
+        lexer::stop_tracing();
+        {
+            std::ostringstream os{};
+            lexer::write_chrome_trace(os);
+        }
+
+        remove_files(file_paths.first);
+        std::filesystem::remove_all(cache_directory, error);
+
+        std::cout << "Concurrent lexing: " << sources_count << " sources checked on " << threads_count <<
+            " threads, " << mismatches_count.load() << " mismatches\n";
+        return mismatches_count == 0;
+    }
+
+    bool check_incremental_lexing(size_t sources_count, uint64_t seed) noexcept
+    {
+        size_t mismatches_count = 0;
+        size_t edits_count = 0;
+        for (size_t i = 0; i < sources_count; ++i)
+        {
+            uint64_t const source_seed = seed + i;
+            lexer::LexerOptions const options = get_check_options(source_seed % check_options_count);
+
+            lexer::IncrementalLexer incremental_lexer{ options };
+            incremental_lexer.open_code(generate_fuzz_source(256 + (source_seed * 97) % 4096, source_seed));
+
+            // engine gives same numbers on every platform, distributions do not
+            std::mt19937_64 random{ source_seed };
+            lexer::LexerContext context{ options };
+            for (size_t edit = 0; edit < incremental_edits_count; ++edit)
+            {
+                size_t const code_size = incremental_lexer.code().size();
+                size_t const begin = random() % (code_size + 1);
+                size_t const end = begin + random() % (std::min(code_size - begin, max_edit_size) + 1);
+                std::string const text = generate_fuzz_source(random() % max_edit_size, random());
+
+                // ranges that are not inside code are refused and change nothing
+                if (edit % 8 == 0 &&
+                    (incremental_lexer.edit(end + 1, end, text) || incremental_lexer.edit(begin, code_size + 1, text) ||
+                    incremental_lexer.code().size() != code_size))
+                {
+                    if (mismatches_count < max_reported_mismatches_count)
+                    {
+                        report_mismatch(
+                            "incremental invalid range, seed " + std::to_string(source_seed) + ", edit " + std::to_string(edit),
+                            "refused",
+                            "done"
+                        );
+                    }
+                    ++mismatches_count;
+                    break;
+                }
+
+                incremental_lexer.edit(begin, end, text);
+                ++edits_count;
+
+                std::string const & code = incremental_lexer.code();
+                context.lex_code(code);
+
+                std::string const expected = format_lexed_code(
+                    code,
+                    context.symbol_table(),
+                    context.tokens(),
+                    context.token_errors()
+                );
+                std::string const actual = format_lexed_code(
+                    code,
+                    incremental_lexer.symbol_table(),
+                    incremental_lexer.tokens(),
+                    incremental_lexer.token_errors()
+                );
+                if (expected == actual)
+                {
+                    continue;
+                }
+
+                if (mismatches_count < max_reported_mismatches_count)
+                {
+                    report_mismatch(
+                        "incremental, seed " + std::to_string(source_seed) + ", edit " + std::to_string(edit),
+                        expected,
+                        actual
+                    );
+                }
+                ++mismatches_count;
+                // next edits would repeat same mismatch
+                break;
+            }
+        }
+
+        std::cout << "Incremental lexing: " << edits_count << " edits of " << sources_count << " sources checked, " <<
+            mismatches_count << " mismatches\n";
+        return mismatches_count == 0;
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace benchmark
+{
+    // checks compare lexing paths that must give same output on fuzz sources,
+    // first mismatches are written to std::cerr, false if there is any
+
+    // get_tokens_parallel with tiny chunks against get_tokens,
+    // with small error caps and token category filters, sources are written to directory
+    bool check_parallel_lexing(std::string const & directory, size_t sources_count, uint64_t seed) noexcept;
+
+    // stress for thread sanitizer: many threads lex same sources at once by get_tokens, get_tokens_parallel,
+    // get_tokens_batch, shared lex cache and own contexts while tracing is on
+    bool check_concurrent_lexing(std::string const & directory, size_t sources_count, uint64_t seed) noexcept;
+
+    // random edits of fuzz sources by IncrementalLexer against lexing of whole edited code,
+    // tokens, symbols, errors and line index are compared
+    bool check_incremental_lexing(size_t sources_count, uint64_t seed) noexcept;
+}
@@ -0,0 +1,338 @@
+#include "micro_benchmarks.h"
+#include "corpus_generator.h"
+#include "allocation_counter.h"
+#include "lexer.h"
+#include "lexer_internal.h"
+#include "char_scan.h"
+
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace benchmark
+{
+    namespace
+    {
+        constexpr size_t symbols_source_size = 8 << 20;
+        constexpr size_t distinct_symbols_counts[] = { 1 << 10, 1 << 12, 1 << 14, 1 << 16, 1 << 18 };
+
+        constexpr size_t keywords_words_count = 1 << 20;
+        // keyword heavy and identifier heavy words
+        constexpr size_t keywords_percents[] = { 80, 10 };
+
+        constexpr size_t char_scan_source_size = 16 << 20;
+
+        constexpr size_t block_comments_source_size = 16 << 20;
+        constexpr size_t comment_lines_counts[] = { 1000, 4000, 16000 };
+
+        // result is kept, so measured work is not removed by optimizer
+        size_t volatile benchmark_sink{ 0 };
+
+        template <typename Function>
+        double measure_median_milliseconds(size_t repetitions, Function && function) noexcept
+        {
+            // first run warms caches and is not measured
+            function();
+
+            std::vector<double> milliseconds{};
+            for (size_t i = 0; i < repetitions; ++i)
+            {
+                auto const begin = std::chrono::steady_clock::now();
+                function();
+                auto const end = std::chrono::steady_clock::now();
+                milliseconds.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+            }
+
+            std::sort(milliseconds.begin(), milliseconds.end());
+            return milliseconds[milliseconds.size() / 2];
+        }
+
+        double nanoseconds_per_item(double milliseconds, size_t items_count) noexcept
+        {
+            return milliseconds * 1e6 / static_cast<double>(std::max<size_t>(items_count, 1));
+        }
+
+        // same source size for every count, so time per token must not grow with table
+        void run_symbols_benchmark(std::ostream & os, size_t repetitions, uint64_t seed) noexcept
+        {
+            os << std::setw(18) << "distinct symbols" << std::setw(14) << "tokens" <<
+                std::setw(14) << "median ms" << std::setw(14) << "ns/token" << "\n";
+
+            lexer::LexerContext context{};
+            for (size_t const distinct_symbols_count : distinct_symbols_counts)
+            {
+                std::string const source = generate_distinct_symbols_source(symbols_source_size, distinct_symbols_count, seed);
+
+                double const milliseconds = measure_median_milliseconds(repetitions, [&context, &source]()
+                    {
+                        context.lex_code(source);
+                        benchmark_sink = context.tokens().size();
+                    });
+
+                size_t const tokens_count = context.tokens().size();
+                os << std::setw(18) << context.symbol_table().size() << std::setw(14) << tokens_count <<
+                    std::setw(14) << milliseconds << std::setw(14) << nanoseconds_per_item(milliseconds, tokens_count) << "\n";
+            }
+        }
+
+        // keyword lookup before perfect hash: every keyword is compared
+        std::pair<lexer::TokenType, bool> try_get_keywords_linear(std::string_view word) noexcept
+        {
+            for (
+                size_t i = static_cast<size_t>(lexer::TokenType::KeywordsBegin) + 1;
+                i < static_cast<size_t>(lexer::TokenType::KeywordsEnd);
+                ++i
+                )
+            {
+                if (word == std::string_view{ lexer::Token_to_string[i] })
+                {
+                    return { static_cast<lexer::TokenType>(i), true };
+                }
+            }
+            return { lexer::TokenType::Invalid, false };
+        }
+
+        template <typename Lookup>
+        size_t count_keywords(std::vector<std::string> const & words, Lookup && lookup) noexcept
+        {
+            size_t keywords_count = 0;
+            for (std::string const & word : words)
+            {
+                keywords_count += (lookup(word).second ? 1 : 0);
+            }
+            return keywords_count;
+        }
+
+        void run_keywords_benchmark(std::ostream & os, size_t repetitions, uint64_t seed) noexcept
+        {
+            os << std::setw(12) << "keywords %" << std::setw(14) << "words" <<
+                std::setw(16) << "linear ns/word" << std::setw(16) << "hash ns/word" << std::setw(10) << "speedup" << "\n";
+
+            for (size_t const keywords_percent : keywords_percents)
+            {
+                std::vector<std::string> const words = generate_words(keywords_words_count, keywords_percent, seed);
+
+                double const linear_milliseconds = measure_median_milliseconds(repetitions, [&words]()
+                    {
+                        benchmark_sink = count_keywords(words, try_get_keywords_linear);
+                    });
+                double const hash_milliseconds = measure_median_milliseconds(repetitions, [&words]()
+                    {
+                        benchmark_sink = count_keywords(words, lexer::try_get_keywords);
+                    });
+
+                os << std::setw(12) << keywords_percent << std::setw(14) << words.size() <<
+                    std::setw(16) << nanoseconds_per_item(linear_milliseconds, words.size()) <<
+                    std::setw(16) << nanoseconds_per_item(hash_milliseconds, words.size()) <<
+                    std::setw(10) << linear_milliseconds / hash_milliseconds << "\n";
+            }
+        }
+
+        using skip_function_t = size_t(*)(std::string_view code, size_t position) noexcept;
+
+        // scanning as lexer does: run is skipped from every position where previous one ended
+        size_t count_runs(std::string_view code, skip_function_t skip) noexcept
+        {
+            size_t runs_count = 0;
+            size_t position = 0;
+            while (position < code.size())
+            {
+                size_t const end = skip(code, position);
+                runs_count += (end != position ? 1 : 0);
+                position = end + 1;
+            }
+            return runs_count;
+        }
+
+        // character classification before flags table and vector kernels
+        size_t skip_spaces_locale(std::string_view code, size_t position) noexcept
+        {
+            while (position < code.size() && std::isspace(static_cast<unsigned char>(code[position])))
+            {
+                ++position;
+            }
+            return position;
+        }
+
+        size_t skip_word_part_locale(std::string_view code, size_t position) noexcept
+        {
+            while (position < code.size() && (std::isalnum(static_cast<unsigned char>(code[position])) || code[position] == '_'))
+            {
+                ++position;
+            }
+            return position;
+        }
+
+        size_t skip_spaces_table(std::string_view code, size_t position) noexcept
+        {
+            while (position < code.size() && lexer::has_char_flag(code[position], lexer::SpaceFlag))
+            {
+                ++position;
+            }
+            return position;
+        }
+
+        size_t skip_word_part_table(std::string_view code, size_t position) noexcept
+        {
+            while (position < code.size() && lexer::has_char_flag(code[position], lexer::WordPartFlag))
+            {
+                ++position;
+            }
+            return position;
+        }
+
+        double megabytes_per_second(double milliseconds, size_t size) noexcept
+        {
+            return static_cast<double>(size) / (1 << 20) / (milliseconds / 1000.0);
+        }
+
+        void run_char_scan_benchmark(std::ostream & os, size_t repetitions, uint64_t seed) noexcept
+        {
+            struct ScanCase
+            {
+                char const * name;
+                std::string source;
+                skip_function_t skip_locale;
+                skip_function_t skip_table;
+                skip_function_t skip_vector;
+            };
+
+            ScanCase const scan_cases[] =
+            {
+                {
+                    "indentation spaces",
+                    generate_indented_source(char_scan_source_size, seed),
+                    skip_spaces_locale,
+                    skip_spaces_table,
+                    lexer::skip_spaces
+                },
+                {
+                    "long identifiers",
+                    generate_long_identifiers_source(char_scan_source_size, seed),
+                    skip_word_part_locale,
+                    skip_word_part_table,
+                    lexer::skip_word_part
+                }
+            };
+
+            os << std::setw(20) << "corpus" << std::setw(16) << "locale MB/s" << std::setw(16) << "table MB/s" <<
+                std::setw(16) << "vector MB/s" << std::setw(16) << "lexing MB/s" << "\n";
+
+            lexer::LexerContext context{};
+            for (ScanCase const & scan_case : scan_cases)
+            {
+                std::string_view const source = scan_case.source;
+                auto const measure_skip = [repetitions, source](skip_function_t skip)
+                    {
+                        return measure_median_milliseconds(repetitions, [source, skip]()
+                            {
+                                benchmark_sink = count_runs(source, skip);
+                            });
+                    };
+
+                double const locale_milliseconds = measure_skip(scan_case.skip_locale);
+                double const table_milliseconds = measure_skip(scan_case.skip_table);
+                double const vector_milliseconds = measure_skip(scan_case.skip_vector);
+                double const lexing_milliseconds = measure_median_milliseconds(repetitions, [&context, source]()
+                    {
+                        context.lex_code(source);
+                        benchmark_sink = context.tokens().size();
+                    });
+
+                os << std::setw(20) << scan_case.name <<
+                    std::setw(16) << megabytes_per_second(locale_milliseconds, source.size()) <<
+                    std::setw(16) << megabytes_per_second(table_milliseconds, source.size()) <<
+                    std::setw(16) << megabytes_per_second(vector_milliseconds, source.size()) <<
+                    std::setw(16) << megabytes_per_second(lexing_milliseconds, source.size()) << "\n";
+            }
+        }
+
+        // what lexing did before comments became spans: every line of comment was appended to its text
+        size_t copy_block_comments(std::string_view source) noexcept
+        {
+            size_t copied_size = 0;
+            size_t position = source.find("/*");
+            while (position != std::string_view::npos)
+            {
+                size_t const end = std::min(source.find("*/", position), source.size());
+                std::string text{};
+                while (position < end)
+                {
+                    size_t const line_end = std::min(source.find('\n', position), end);
+                    text += std::string{ source.substr(position, line_end - position) };
+                    text += '\n';
+                    position = line_end + 1;
+                }
+                copied_size += text.size();
+                position = source.find("/*", end);
+            }
+            return copied_size;
+        }
+
+        void run_block_comments_benchmark(std::ostream & os, size_t repetitions, uint64_t seed) noexcept
+        {
+            os << std::setw(16) << "comment lines" << std::setw(14) << "lexing MB/s" << std::setw(16) << "allocations" <<
+                std::setw(22) << "line copying MB/s" << "\n";
+
+            for (size_t const comment_lines_count : comment_lines_counts)
+            {
+                std::string const source = generate_block_comments_source(block_comments_source_size, comment_lines_count, seed);
+
+                double const lexing_milliseconds = measure_median_milliseconds(repetitions, [&source]()
+                    {
+                        lexer::LexerContext context{};
+                        context.lex_code(source);
+                        benchmark_sink = context.tokens().size();
+                    });
+
+                // new context every time, so its buffers are counted too
+                reset_allocation_statistics();
+                {
+                    lexer::LexerContext context{};
+                    context.lex_code(source);
+                }
+                size_t const allocations_count = get_allocation_statistics().allocations_count;
+
+                double const copying_milliseconds = measure_median_milliseconds(repetitions, [&source]()
+                    {
+                        benchmark_sink = copy_block_comments(source);
+                    });
+
+                os << std::setw(16) << comment_lines_count <<
+                    std::setw(14) << megabytes_per_second(lexing_milliseconds, source.size()) <<
+                    std::setw(16) << allocations_count <<
+                    std::setw(22) << megabytes_per_second(copying_milliseconds, source.size()) << "\n";
+            }
+        }
+    }
+
+    void run_micro_benchmark(std::ostream & os, MicroBenchmarkKind kind, size_t repetitions, uint64_t seed) noexcept
+    {
+        os << std::fixed << std::setprecision(3);
+        os << Micro_benchmark_kind_to_string[static_cast<uint8_t>(kind)] << ":\n";
+
+        switch (kind)
+        {
+        case MicroBenchmarkKind::Symbols:
+            run_symbols_benchmark(os, repetitions, seed);
+            break;
+        case MicroBenchmarkKind::Keywords:
+            run_keywords_benchmark(os, repetitions, seed);
+            break;
+        case MicroBenchmarkKind::CharScan:
+            run_char_scan_benchmark(os, repetitions, seed);
+            break;
+        case MicroBenchmarkKind::BlockComments:
+            run_block_comments_benchmark(os, repetitions, seed);
+            break;
+        default:
+            break;
+        }
+        os << "\n";
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace benchmark
+{
+    // focused benchmarks of one lexer part on sources made for it, they are lexed from memory,
+    // results are written as text table
+    enum class MicroBenchmarkKind : uint8_t
+    {
+        // lexing time by distinct symbols count at same source size
+        Symbols,
+        // perfect hash keyword lookup against linear search in Token_to_string that it replaced
+        Keywords,
+        // whitespace and identifier scanning: locale functions, flags table and vector kernels
+        CharScan,
+        // multi-line comments that are spans of source, against copying them line by line
+        BlockComments,
+
+        CountOf
+    };
+
+    constexpr char const * Micro_benchmark_kind_to_string[static_cast<uint8_t>(MicroBenchmarkKind::CountOf)] =
+    {
+        "symbols",
+        "keywords",
+        "char_scan",
+        "block_comments"
+    };
+
+    void run_micro_benchmark(std::ostream & os, MicroBenchmarkKind kind, size_t repetitions, uint64_t seed) noexcept;
+}